@@ -1,22 +1,13 @@
 // Copyright (c) embedded ocean GmbH
 #pragma once
 
-#include "Types.hpp"
-#include "CommonReadState.hpp"
-#include "ReadCommand.hpp"
-
-#include <xentara/memory/Array.hpp>
-#include <xentara/memory/WriteSentinel.hpp>
-#include <xentara/utils/eh/expected.hpp>
-
-#include <chrono>
-#include <system_error>
 #include <cstdlib>
 
 namespace xentara::plugins::templateDriver
 {
 
 class TemplateIoComponent;
+class DecodePlan;
 
 /// @brief Base class for inputs and outputs that can be read by an I/O transaction
 ///
@@ -35,28 +26,13 @@ public:
 	/// @todo give this a more descriptive name, e.g. "_device"
 	virtual auto ioComponent() const -> const TemplateIoComponent & = 0;
 	
-	/// @brief Attaches the input to its I/O transaction
-	/// @param dataArray The data array that the attributes should be added to. The caller will use the information in this array
-	/// to allocate the data block.
-	/// @param eventCount A variable that counts the total number of events than can be raised for a single update.
-	/// The maximum number of events that update() will request to be raised will be added to this variable. The caller will use this
-	/// event count to preallocate a buffer when collecting the events to raise after an update.
-	virtual auto attachInput(memory::Array &dataArray, std::size_t &eventCount) -> void = 0;
-
-	/// @brief Updates the read state and collects the events to send
-	/// @param writeSentinel A write sentinel for the data block the data is stored in
-	/// @param timeStamp The update time stamp
-	/// @param payloadOrError This is a variant-like type that will hold either the payload of the read command, or an std::error_code object
-	/// containing a read error.
-	/// @param commonChanges An object containing information about which parts of the common read state changed, if any.
-	/// @param eventsToRaise Any events that need to be raised as a result of the update will be added to this
-	/// list. The events will not be raised directly, because the write sentinel needs to be commited first,
-	/// which is done by the caller.
-	virtual auto updateReadState(WriteSentinel &writeSentinel,
-		std::chrono::system_clock::time_point timeStamp,
-		const utils::eh::expected<std::reference_wrapper<const ReadCommand::Payload>, std::error_code> &payloadOrError,
-		const CommonReadState::Changes &commonChanges,
-		PendingEventList &eventsToRaise) -> void = 0;
+	/// @brief Attaches the input to its I/O transaction by adding it to the transaction's decode plan
+	///
+	/// The input adds the information needed to decode and store its value. The decode plan takes care of attaching the
+	/// state to the transaction's data array, so that the I/O transaction can decide on the layout of the data block.
+	/// @param decodePlan The decode plan of the I/O transaction. The I/O transaction uses this plan to update all its inputs
+	/// when a read command completes.
+	virtual auto addToDecodePlan(DecodePlan &decodePlan) -> void = 0;
 };
 
 inline AbstractInput::~AbstractInput() = default;
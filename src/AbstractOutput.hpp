@@ -3,6 +3,8 @@
 
 #include "Types.hpp"
 #include "CommonReadState.hpp"
+#include "ReadCommand.hpp"
+#include "WriteState.hpp"
 
 #include <xentara/memory/Array.hpp>
 #include <xentara/memory/WriteSentinel.hpp>
@@ -15,6 +17,7 @@ namespace xentara::plugins::templateDriver
 {
 
 class WriteCommand;
+class WriteGroup;
 
 /// @brief Base class for outputs that can be written by an I/O transaction
 class AbstractOutput
@@ -38,7 +41,25 @@ public:
 	/// event count to preallocate a buffer when collecting the events to raise after an update.
 	virtual auto attachOutput(memory::Array &dataArray, std::size_t &eventCount) -> void = 0;
 
+	/// @brief Gets the write state of the output.
+	///
+	/// This is used by the I/O transaction to carry over the write state of outputs that were not written in a cycle.
+	virtual auto writeState() const noexcept -> const WriteState & = 0;
+
+	/// @brief Adds a slot for the output to the write group of its I/O transaction, if the output is staged
+	/// @param writeGroup The write group
+	virtual auto attachWriteGroup(WriteGroup &writeGroup) -> void = 0;
+
+	/// @brief Adds the maximum number and size of the values the output adds to a single write command
+	/// @param valueCount A variable that counts the total number of values. The maximum number of values addToWriteCommand()
+	/// will add must be added to this variable.
+	/// @param dataSize A variable that counts the total size of the encoded values, in bytes. The maximum size of the values
+	/// addToWriteCommand() will add must be added to this variable.
+	virtual auto addWriteCapacity(std::size_t &valueCount, std::size_t &dataSize) const -> void = 0;
+
 	/// @brief Adds any pending output value to a write command.
+	///
+	/// This is only called for outputs that were marked using TemplateIoTransaction::markOutputPending().
 	/// @param command The write command to add the value to.
 	/// @return This function must return *true* if data was added, or *false* if no value was pending.
 	virtual auto addToWriteCommand(WriteCommand &command) -> bool = 0;
@@ -55,6 +76,35 @@ public:
 		std::chrono::system_clock::time_point timeStamp,
 		std::error_code error,
 		PendingEventList &eventsToRaise) -> void = 0;
+
+	/// @brief Checks whether successfully written values are reflected in the read-back value right away
+	virtual auto readsBackWrites() const noexcept -> bool = 0;
+
+	/// @brief Sets the read-back value to the value last successfully written, without waiting for the next read
+	///
+	/// This is called after a successful write for all outputs that were written, if readsBackWrites() returns *true*.
+	/// @param writeSentinel A write sentinel for the data block the read-back value is stored in
+	/// @param timeStamp The time stamp of the write
+	/// @param eventsToRaise Any events that need to be raised as a result of the update will be added to this
+	/// list. The events will not be raised directly, because the write sentinel needs to be commited first,
+	/// which is done by the caller.
+	virtual auto updateReadBack(
+		WriteSentinel &writeSentinel,
+		std::chrono::system_clock::time_point timeStamp,
+		PendingEventList &eventsToRaise) -> void = 0;
+
+	/// @brief Forgets which value the device was last known to have
+	///
+	/// This is called when the I/O component reports an error or reconnects, because the device may have been restarted
+	/// or changed in the meantime. This function may be called on any thread.
+	virtual auto forgetWrittenValue() noexcept -> void = 0;
+
+	/// @brief Checks the read-back value against the value the device was last known to have
+	///
+	/// This is called on the reading thread after every successful read that started after the last write. If the payload
+	/// holds a different value, the output must forget the written value, as with forgetWrittenValue().
+	/// @param payload The payload of the read command
+	virtual auto checkReadBack(const ReadCommand::Payload &payload) noexcept -> void = 0;
 };
 
 inline AbstractOutput::~AbstractOutput() = default;
@@ -21,4 +21,10 @@ const model::Attribute kConnectionTime { "deadbeef-dead-beef-dead-beefdeadbeef"_
 /// @todo assign a unique UUID
 const model::Attribute kDeviceError { "abababab-abab-abab-abab-abababababab"_uuid, "error"sv, model::Attribute::Access::ReadOnly, data::DataType::kErrorCode };
 
+/// @todo assign a unique UUID
+const model::Attribute kThrottledWriteCount { "cdcdcdcd-cdcd-cdcd-cdcd-cdcdcdcdcdcd"_uuid, "throttledWriteCount"sv, model::Attribute::Access::ReadOnly, data::DataType::kInteger };
+
+/// @todo assign a unique UUID
+const model::Attribute kNextConnectionAttempt { "efefefef-efef-efef-efef-efefefefefef"_uuid, "nextConnectionAttempt"sv, model::Attribute::Access::ReadOnly, data::DataType::kTimeStamp };
+
 } // namespace xentara::plugins::templateDriver::attributes
@@ -16,5 +16,9 @@ extern const model::Attribute kWriteError;
 extern const model::Attribute kConnectionTime;
 /// @brief A Xentara attribute containing an error code for an I/O component
 extern const model::Attribute kDeviceError;
+/// @brief A Xentara attribute containing the number of writes that were deferred by the rate limit of an I/O component
+extern const model::Attribute kThrottledWriteCount;
+/// @brief A Xentara attribute containing the time of the next connection attempt of an I/O component
+extern const model::Attribute kNextConnectionAttempt;
 
 } // namespace xentara::plugins::templateDriver::attributes
\ No newline at end of file
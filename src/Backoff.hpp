@@ -0,0 +1,37 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <limits>
+
+namespace xentara::plugins::templateDriver
+{
+
+/// @brief Calculates an exponential backoff delay
+///
+/// The delay is doubled for every consecutive failure after the first, up to a maximum. It is calculated directly rather than
+/// by repeated doubling, so the cost does not grow with the number of failures, and it cannot overflow.
+/// @param baseDelay The delay after the first failure
+/// @param maxDelay The maximum delay
+/// @param failureCount The number of consecutive failures, including the current one. Must be at least 1.
+/// @return The delay, which is never larger than maxDelay
+template <typename Rep, typename Period>
+constexpr auto backoffDelay(std::chrono::duration<Rep, Period> baseDelay,
+	std::chrono::duration<Rep, Period> maxDelay,
+	std::size_t failureCount) noexcept -> std::chrono::duration<Rep, Period>
+{
+	// Clamp the exponent to the number of value bits of the representation, so that the shifts below are well-defined
+	const auto exponent = std::min<std::size_t>(failureCount - 1, std::numeric_limits<Rep>::digits - 1);
+
+	// Check whether baseDelay * 2^exponent would exceed the maximum, without actually calculating it
+	if (baseDelay.count() > (maxDelay.count() >> exponent))
+	{
+		return maxDelay;
+	}
+
+	return baseDelay * (Rep(1) << exponent);
+}
+
+} // namespace xentara::plugins::templateDriver
@@ -0,0 +1,187 @@
+// Copyright (c) embedded ocean GmbH
+#include "ChangeDetection.hpp"
+
+#include "Deadband.hpp"
+
+#include <bit>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#	define TEMPLATE_DRIVER_CHANGE_DETECTION_AVX2
+#	include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define TEMPLATE_DRIVER_CHANGE_DETECTION_SSE2
+#	include <emmintrin.h>
+#endif
+
+namespace xentara::plugins::templateDriver
+{
+
+// The vectorized code blends change times as 64-bit integers
+static_assert(sizeof(std::chrono::system_clock::time_point) == sizeof(std::int64_t));
+
+auto detectChanges(std::span<const double> values,
+	std::span<const double> oldValues,
+	std::span<std::chrono::system_clock::time_point> changeTimes,
+	std::span<const std::chrono::system_clock::time_point> oldChangeTimes,
+	std::chrono::system_clock::time_point timeStamp,
+	std::span<std::uint8_t> changed) noexcept -> std::size_t
+{
+	const auto count = values.size();
+	std::size_t index { 0 };
+	std::size_t changeCount { 0 };
+
+#if defined(TEMPLATE_DRIVER_CHANGE_DETECTION_AVX2)
+	// Process four values at a time
+	const auto stamp = _mm256_castsi256_pd(_mm256_set1_epi64x(timeStamp.time_since_epoch().count()));
+	for (; index + 4 <= count; index += 4)
+	{
+		// Compare the values. _CMP_NEQ_UQ yields true for NaNs, just like the != operator.
+		const auto newValue = _mm256_loadu_pd(&values[index]);
+		const auto oldValue = _mm256_loadu_pd(&oldValues[index]);
+		const auto mask = _mm256_cmp_pd(newValue, oldValue, _CMP_NEQ_UQ);
+
+		// Select the new change times
+		const auto oldChangeTime = _mm256_loadu_pd(reinterpret_cast<const double *>(&oldChangeTimes[index]));
+		_mm256_storeu_pd(reinterpret_cast<double *>(&changeTimes[index]), _mm256_blendv_pd(oldChangeTime, stamp, mask));
+
+		// Record which values changed
+		const auto bits = unsigned(_mm256_movemask_pd(mask));
+		changed[index] = std::uint8_t(bits & 1);
+		changed[index + 1] = std::uint8_t((bits >> 1) & 1);
+		changed[index + 2] = std::uint8_t((bits >> 2) & 1);
+		changed[index + 3] = std::uint8_t((bits >> 3) & 1);
+		changeCount += std::size_t(std::popcount(bits));
+	}
+#elif defined(TEMPLATE_DRIVER_CHANGE_DETECTION_SSE2)
+	// Process two values at a time
+	const auto stamp = _mm_castsi128_pd(_mm_set1_epi64x(timeStamp.time_since_epoch().count()));
+	for (; index + 2 <= count; index += 2)
+	{
+		// Compare the values. _mm_cmpneq_pd() yields true for NaNs, just like the != operator.
+		const auto newValue = _mm_loadu_pd(&values[index]);
+		const auto oldValue = _mm_loadu_pd(&oldValues[index]);
+		const auto mask = _mm_cmpneq_pd(newValue, oldValue);
+
+		// Select the new change times. SSE2 has no blend instruction, so we use bitwise operations.
+		const auto oldChangeTime = _mm_loadu_pd(reinterpret_cast<const double *>(&oldChangeTimes[index]));
+		const auto changeTime = _mm_or_pd(_mm_and_pd(mask, stamp), _mm_andnot_pd(mask, oldChangeTime));
+		_mm_storeu_pd(reinterpret_cast<double *>(&changeTimes[index]), changeTime);
+
+		// Record which values changed
+		const auto bits = unsigned(_mm_movemask_pd(mask));
+		changed[index] = std::uint8_t(bits & 1);
+		changed[index + 1] = std::uint8_t((bits >> 1) & 1);
+		changeCount += std::size_t(std::popcount(bits));
+	}
+#endif
+
+	// Process the remaining values one by one
+	for (; index < count; ++index)
+	{
+		const bool valueChanged = values[index] != oldValues[index];
+		changeTimes[index] = valueChanged ? timeStamp : oldChangeTimes[index];
+		changed[index] = std::uint8_t(valueChanged);
+		changeCount += std::size_t(valueChanged);
+	}
+
+	return changeCount;
+}
+
+auto detectSignificantChanges(std::span<double> values,
+	std::span<const double> oldValues,
+	std::span<const double> absoluteDeadbands,
+	std::span<const double> relativeDeadbands,
+	std::span<std::chrono::system_clock::time_point> changeTimes,
+	std::span<const std::chrono::system_clock::time_point> oldChangeTimes,
+	std::chrono::system_clock::time_point timeStamp,
+	std::span<std::uint8_t> changed) noexcept -> std::size_t
+{
+	const auto count = values.size();
+	std::size_t index { 0 };
+	std::size_t changeCount { 0 };
+
+#if defined(TEMPLATE_DRIVER_CHANGE_DETECTION_AVX2)
+	// Process four values at a time
+	const auto stamp = _mm256_castsi256_pd(_mm256_set1_epi64x(timeStamp.time_since_epoch().count()));
+	const auto signBit = _mm256_set1_pd(-0.0);
+	for (; index + 4 <= count; index += 4)
+	{
+		const auto newValue = _mm256_loadu_pd(&values[index]);
+		const auto oldValue = _mm256_loadu_pd(&oldValues[index]);
+
+		// Compute the magnitude of the change and the deadband. Clearing the sign bit yields the absolute value.
+		const auto difference = _mm256_andnot_pd(signBit, _mm256_sub_pd(newValue, oldValue));
+		const auto relativeDeadband = _mm256_mul_pd(_mm256_loadu_pd(&relativeDeadbands[index]), _mm256_andnot_pd(signBit, oldValue));
+		const auto deadband = _mm256_max_pd(_mm256_loadu_pd(&absoluteDeadbands[index]), relativeDeadband);
+
+		// A value changed if it is different and the difference is not within the deadband. The unordered predicates
+		// yield true for NaNs, just like Deadband::significant() and the != operator.
+		const auto significant = _mm256_cmp_pd(difference, deadband, _CMP_NLE_UQ);
+		const auto mask = _mm256_and_pd(_mm256_cmp_pd(newValue, oldValue, _CMP_NEQ_UQ), significant);
+
+		// Keep the old value for insignificant changes, and select the new change times
+		_mm256_storeu_pd(&values[index], _mm256_blendv_pd(oldValue, newValue, mask));
+		const auto oldChangeTime = _mm256_loadu_pd(reinterpret_cast<const double *>(&oldChangeTimes[index]));
+		_mm256_storeu_pd(reinterpret_cast<double *>(&changeTimes[index]), _mm256_blendv_pd(oldChangeTime, stamp, mask));
+
+		// Record which values changed
+		const auto bits = unsigned(_mm256_movemask_pd(mask));
+		changed[index] = std::uint8_t(bits & 1);
+		changed[index + 1] = std::uint8_t((bits >> 1) & 1);
+		changed[index + 2] = std::uint8_t((bits >> 2) & 1);
+		changed[index + 3] = std::uint8_t((bits >> 3) & 1);
+		changeCount += std::size_t(std::popcount(bits));
+	}
+#elif defined(TEMPLATE_DRIVER_CHANGE_DETECTION_SSE2)
+	// Process two values at a time
+	const auto stamp = _mm_castsi128_pd(_mm_set1_epi64x(timeStamp.time_since_epoch().count()));
+	const auto signBit = _mm_set1_pd(-0.0);
+	for (; index + 2 <= count; index += 2)
+	{
+		const auto newValue = _mm_loadu_pd(&values[index]);
+		const auto oldValue = _mm_loadu_pd(&oldValues[index]);
+
+		// Compute the magnitude of the change and the deadband. Clearing the sign bit yields the absolute value.
+		const auto difference = _mm_andnot_pd(signBit, _mm_sub_pd(newValue, oldValue));
+		const auto relativeDeadband = _mm_mul_pd(_mm_loadu_pd(&relativeDeadbands[index]), _mm_andnot_pd(signBit, oldValue));
+		const auto deadband = _mm_max_pd(_mm_loadu_pd(&absoluteDeadbands[index]), relativeDeadband);
+
+		// A value changed if it is different and the difference is not within the deadband. The "not" comparisons
+		// yield true for NaNs, just like Deadband::significant() and the != operator.
+		const auto significant = _mm_cmpnle_pd(difference, deadband);
+		const auto mask = _mm_and_pd(_mm_cmpneq_pd(newValue, oldValue), significant);
+
+		// Keep the old value for insignificant changes, and select the new change times.
+		// SSE2 has no blend instruction, so we use bitwise operations.
+		_mm_storeu_pd(&values[index], _mm_or_pd(_mm_and_pd(mask, newValue), _mm_andnot_pd(mask, oldValue)));
+		const auto oldChangeTime = _mm_loadu_pd(reinterpret_cast<const double *>(&oldChangeTimes[index]));
+		const auto changeTime = _mm_or_pd(_mm_and_pd(mask, stamp), _mm_andnot_pd(mask, oldChangeTime));
+		_mm_storeu_pd(reinterpret_cast<double *>(&changeTimes[index]), changeTime);
+
+		// Record which values changed
+		const auto bits = unsigned(_mm_movemask_pd(mask));
+		changed[index] = std::uint8_t(bits & 1);
+		changed[index + 1] = std::uint8_t((bits >> 1) & 1);
+		changeCount += std::size_t(std::popcount(bits));
+	}
+#endif
+
+	// Process the remaining values one by one
+	for (; index < count; ++index)
+	{
+		const Deadband deadband { absoluteDeadbands[index], relativeDeadbands[index] };
+		const bool valueChanged = values[index] != oldValues[index] && deadband.significant(values[index], oldValues[index]);
+		if (!valueChanged)
+		{
+			values[index] = oldValues[index];
+		}
+		changeTimes[index] = valueChanged ? timeStamp : oldChangeTimes[index];
+		changed[index] = std::uint8_t(valueChanged);
+		changeCount += std::size_t(valueChanged);
+	}
+
+	return changeCount;
+}
+
+} // namespace xentara::plugins::templateDriver
@@ -0,0 +1,82 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace xentara::plugins::templateDriver
+{
+
+/// @brief Detects which values of a contiguous array have changed, and updates their change times accordingly.
+///
+/// A value is considered changed if it compares unequal to the old value using the != operator. Change times of changed
+/// values are set to the time stamp, change times of unchanged values are copied from the old change times.
+///
+/// This function uses AVX2 or SSE2 instructions if the compiler was configured to generate them, and a scalar loop otherwise.
+/// @param values The new values
+/// @param oldValues The old values. Must have the same size as *values*.
+/// @param changeTimes Receives the new change times. Must have the same size as *values*.
+/// @param oldChangeTimes The old change times. Must have the same size as *values*.
+/// @param timeStamp The time stamp to use for changed values
+/// @param changed Receives 1 for each value that changed, and 0 for each value that didn't. Must have the same size as *values*.
+/// @return The number of values that changed
+auto detectChanges(std::span<const double> values,
+	std::span<const double> oldValues,
+	std::span<std::chrono::system_clock::time_point> changeTimes,
+	std::span<const std::chrono::system_clock::time_point> oldChangeTimes,
+	std::chrono::system_clock::time_point timeStamp,
+	std::span<std::uint8_t> changed) noexcept -> std::size_t;
+
+/// @brief Detects which values of a contiguous array have changed, and updates their change times accordingly.
+///
+/// This is the generic version for value types other than double. It uses a simple loop, which the compiler is free to vectorize.
+/// The parameters and return value are the same as for the version for double.
+template <std::regular DataType>
+auto detectChanges(std::span<const DataType> values,
+	std::span<const DataType> oldValues,
+	std::span<std::chrono::system_clock::time_point> changeTimes,
+	std::span<const std::chrono::system_clock::time_point> oldChangeTimes,
+	std::chrono::system_clock::time_point timeStamp,
+	std::span<std::uint8_t> changed) noexcept -> std::size_t
+{
+	std::size_t changeCount { 0 };
+	for (std::size_t index = 0; index < values.size(); ++index)
+	{
+		const bool valueChanged = values[index] != oldValues[index];
+		changeTimes[index] = valueChanged ? timeStamp : oldChangeTimes[index];
+		changed[index] = std::uint8_t(valueChanged);
+		changeCount += std::size_t(valueChanged);
+	}
+
+	return changeCount;
+}
+
+/// @brief Detects which values of a contiguous array have changed significantly, and updates the values and their change times accordingly.
+///
+/// A value is considered changed if it compares unequal to the old value using the != operator, and the change exceeds its deadband,
+/// as determined by Deadband::significant(). Values that did not change significantly are reset to the old value.
+/// Change times of changed values are set to the time stamp, change times of unchanged values are copied from the old change times.
+///
+/// This function uses AVX2 or SSE2 instructions if the compiler was configured to generate them, and a scalar loop otherwise.
+/// @param values The new values. Values whose change is not significant are replaced with the old value.
+/// @param oldValues The old values. Must have the same size as *values*.
+/// @param absoluteDeadbands The absolute deadbands for the values. Must have the same size as *values*.
+/// @param relativeDeadbands The relative deadbands for the values. Must have the same size as *values*.
+/// @param changeTimes Receives the new change times. Must have the same size as *values*.
+/// @param oldChangeTimes The old change times. Must have the same size as *values*.
+/// @param timeStamp The time stamp to use for changed values
+/// @param changed Receives 1 for each value that changed, and 0 for each value that didn't. Must have the same size as *values*.
+/// @return The number of values that changed
+auto detectSignificantChanges(std::span<double> values,
+	std::span<const double> oldValues,
+	std::span<const double> absoluteDeadbands,
+	std::span<const double> relativeDeadbands,
+	std::span<std::chrono::system_clock::time_point> changeTimes,
+	std::span<const std::chrono::system_clock::time_point> oldChangeTimes,
+	std::chrono::system_clock::time_point timeStamp,
+	std::span<std::uint8_t> changed) noexcept -> std::size_t;
+
+} // namespace xentara::plugins::templateDriver
@@ -86,6 +86,15 @@ public:
 		std::error_code error,
 		PendingEventList &eventsToRaise) -> Changes;
 
+	/// @brief Keeps the data unchanged
+	///
+	/// This must be called when committing the data block without updating the state, because memory resources use swap-in.
+	/// @param writeSentinel A write sentinel for the data block the data is stored in
+	auto keep(WriteSentinel &writeSentinel) const noexcept -> void
+	{
+		writeSentinel[_stateHandle] = writeSentinel.oldValues()[_stateHandle];
+	}
+
 private:
 	/// @brief This structure is used to represent the state inside the memory block
 	struct State final
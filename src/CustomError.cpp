@@ -47,6 +47,15 @@ namespace
 		case CustomError::NoData:
 			return "no data was read yet"s;
 
+		case CustomError::ResponseTooShort:
+			return "the response from the device is too short"s;
+
+		case CustomError::QueueFull:
+			return "too many values are waiting to be written"s;
+
+		case CustomError::KeepaliveTimeout:
+			return "the device did not respond to keepalive probes"s;
+
 		/// @todo Add messages for other error codes
 
 		case CustomError::UnknownError:
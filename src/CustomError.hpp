@@ -19,6 +19,12 @@ enum class CustomError
 	NotConnected,
 	/// @brief No data has been read yet.
 	NoData,
+	/// @brief The response from the device did not contain all the data requested.
+	ResponseTooShort,
+	/// @brief The queue of values to write to an output is full.
+	QueueFull,
+	/// @brief The device did not respond to a keepalive probe.
+	KeepaliveTimeout,
 
 	/// @brief An unknown error occurred
 	UnknownError = 999
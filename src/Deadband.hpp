@@ -0,0 +1,35 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+namespace xentara::plugins::templateDriver
+{
+
+/// @brief A deadband used to suppress insignificant changes of a value
+///
+/// A change is significant if the difference between the new and the old value exceeds either the absolute deadband,
+/// or the relative deadband multiplied by the magnitude of the old value, whichever is larger.
+struct Deadband final
+{
+	/// @brief The absolute deadband
+	double _absolute { 0 };
+	/// @brief The deadband relative to the magnitude of the old value, as a fraction (not a percentage)
+	double _relative { 0 };
+
+	/// @brief Determines whether the deadband suppresses any changes at all
+	constexpr explicit operator bool() const noexcept
+	{
+		return _absolute > 0 || _relative > 0;
+	}
+
+	/// @brief Checks whether a change is significant
+	/// @note This function returns *true* if either value is NaN.
+	auto significant(double newValue, double oldValue) const noexcept -> bool
+	{
+		return !(std::abs(newValue - oldValue) <= std::max(_absolute, _relative * std::abs(oldValue)));
+	}
+};
+
+} // namespace xentara::plugins::templateDriver
@@ -0,0 +1,81 @@
+// Copyright (c) embedded ocean GmbH
+#include "DecodePlan.hpp"
+
+#include <xentara/memory/WriteSentinel.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace xentara::plugins::templateDriver
+{
+
+auto DecodePlan::attach(memory::Array &dataArray, std::size_t &eventCount, ValueLayout layout) -> void
+{
+	switch (layout)
+	{
+	case ValueLayout::Interleaved:
+		// Attach the value and the change time of each state together
+		forEachTable([&](auto &table) { table.attachInterleaved(dataArray, eventCount); });
+		break;
+
+	case ValueLayout::Contiguous:
+		// Attach all the values first, then all the change times
+		forEachTable([&](auto &table) { table.attachValues(dataArray); });
+		forEachTable([&](auto &table) { table.attachChangeTimes(dataArray, eventCount); });
+		break;
+	}
+
+	forEachTable([&](auto &table) { table.finishAttaching(layout); });
+}
+
+auto DecodePlan::partition(std::size_t maxRangeSize) const -> std::vector<PayloadRange>
+{
+	// Collect the byte ranges of all the values, sorted by offset
+	std::vector<PayloadRange> values;
+	forEachTable([&](const auto &table) { table.appendValueRanges(values); });
+	std::ranges::sort(values, {}, &PayloadRange::_offset);
+
+	// Greedily extend each range for as long as the values fit
+	std::vector<PayloadRange> ranges;
+	for (auto &&value : values)
+	{
+		// Make sure the value fits into a range at all
+		if (maxRangeSize != 0 && value._size > maxRangeSize)
+		{
+			throw std::runtime_error("a value of a template I/O transaction is larger than the maximum PDU size of the I/O component");
+		}
+
+		// Extend the current range, if possible
+		if (!ranges.empty())
+		{
+			auto &range = ranges.back();
+			const auto end = std::max(range._offset + range._size, value._offset + value._size);
+			if (maxRangeSize == 0 || end - range._offset <= maxRangeSize)
+			{
+				range._size = end - range._offset;
+				continue;
+			}
+		}
+
+		// Start a new range
+		ranges.push_back(value);
+	}
+
+	return ranges;
+}
+
+auto DecodePlan::update(WriteSentinel &writeSentinel,
+	std::chrono::system_clock::time_point timeStamp,
+	const utils::eh::expected<std::reference_wrapper<const ReadCommand::Payload>, std::error_code> &payloadOrError,
+	const CommonReadState::Changes &commonChanges,
+	PendingEventList &eventsToRaise) -> void
+{
+	forEachTable([&](auto &table) { table.update(writeSentinel, timeStamp, payloadOrError, commonChanges, eventsToRaise); });
+}
+
+auto DecodePlan::keep(WriteSentinel &writeSentinel) const noexcept -> void
+{
+	forEachTable([&](const auto &table) { table.keep(writeSentinel); });
+}
+
+} // namespace xentara::plugins::templateDriver
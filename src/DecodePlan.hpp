@@ -0,0 +1,122 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include "Types.hpp"
+#include "CommonReadState.hpp"
+#include "DecodeTable.hpp"
+#include "Deadband.hpp"
+#include "PerValueReadState.hpp"
+#include "ReadCommand.hpp"
+#include "ValueType.hpp"
+#include "WireType.hpp"
+
+#include <xentara/memory/Array.hpp>
+#include <xentara/utils/eh/expected.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <functional>
+#include <system_error>
+#include <tuple>
+#include <vector>
+
+namespace xentara::plugins::templateDriver
+{
+
+/// @brief A precompiled table describing how to decode the values of all inputs of an I/O transaction.
+///
+/// The plan is built once when the I/O transaction is realized. Each entry contains everything needed to decode
+/// a value from the payload of a read command and store it in the data block, so that all the inputs can be updated
+/// in a single loop, without calling any virtual functions.
+///
+/// The entries are kept in separate tables for each value type, so that decoding and change detection are specialized
+/// for each type at compile time.
+class DecodePlan final
+{
+public:
+	/// @brief A range of bytes within the payload
+	using PayloadRange = templateDriver::PayloadRange;
+
+	/// @brief Adds an entry to the plan
+	/// @param offset The offset of the value within the payload of a read command, in bytes
+	/// @param wireType The encoding of the value within the payload
+	/// @param state The state to store the value in. The state is attached to the data array by attach().
+	/// @param deadband The deadband used to suppress insignificant changes of the value
+	template <std::regular DataType>
+	auto add(std::size_t offset, WireType wireType, PerValueReadState<DataType> &state, const Deadband &deadband = {}) -> void
+	{
+		std::get<DecodeTable<DataType>>(_tables).add(offset, wireType, state, deadband);
+
+		// Make sure the payload is large enough for this value
+		_payloadSize = std::max(_payloadSize, offset + wireSize(wireType));
+	}
+
+	/// @brief Attaches the states of all entries to the I/O transaction
+	/// @param dataArray The data array that the states should be added to. The caller will use the information in this array
+	/// to allocate the data block.
+	/// @param eventCount A variable that counts the total number of events than can be raised for a single update.
+	/// The maximum number of events that update() will request to be raised will be added to this variable. The caller will use this
+	/// event count to preallocate a buffer when collecting the events to raise after an update.
+	/// @param layout The layout to use for the states
+	auto attach(memory::Array &dataArray, std::size_t &eventCount, ValueLayout layout) -> void;
+
+	/// @brief Gets the number of bytes the payload of a read command must contain to decode all the entries
+	auto payloadSize() const noexcept -> std::size_t
+	{
+		return _payloadSize;
+	}
+
+	/// @brief Partitions the payload into ranges that can be read using separate read commands
+	///
+	/// The ranges cover all the entries, and are sorted by offset. No value is split across two ranges.
+	/// @param maxRangeSize The maximum size of a range, or 0 if the size is not limited.
+	/// @return The ranges. If there are no entries, the list is empty.
+	/// @throw std::runtime_error if a single value is larger than *maxRangeSize*.
+	auto partition(std::size_t maxRangeSize) const -> std::vector<PayloadRange>;
+
+	/// @brief Updates the states of all the entries and collects the events to send
+	/// @param writeSentinel A write sentinel for the data block the data is stored in
+	/// @param timeStamp The update time stamp
+	/// @param payloadOrError This is a variant-like type that will hold either the payload of the read command, or an std::error_code object
+	/// containing a read error.
+	/// @param commonChanges An object containing information about which parts of the common read state changed, if any.
+	/// @param eventsToRaise Any events that need to be raised as a result of the update will be added to this
+	/// list. The events will not be raised directly, because the write sentinel needs to be commited first,
+	/// which is done by the caller.
+	auto update(WriteSentinel &writeSentinel,
+		std::chrono::system_clock::time_point timeStamp,
+		const utils::eh::expected<std::reference_wrapper<const ReadCommand::Payload>, std::error_code> &payloadOrError,
+		const CommonReadState::Changes &commonChanges,
+		PendingEventList &eventsToRaise) -> void;
+
+	/// @brief Keeps the states of all the entries unchanged
+	///
+	/// This is used instead of update() if the payload is identical to the last one, and the common read state did not change.
+	/// The data block uses swap-in, so the old values must still be copied into the new data.
+	/// @param writeSentinel A write sentinel for the data block the data is stored in
+	auto keep(WriteSentinel &writeSentinel) const noexcept -> void;
+
+private:
+	/// @brief Calls a function for each table
+	template <typename Function>
+	auto forEachTable(Function &&function) -> void
+	{
+		std::apply([&](auto &...tables) { (function(tables), ...); }, _tables);
+	}
+	/// @overload
+	template <typename Function>
+	auto forEachTable(Function &&function) const -> void
+	{
+		std::apply([&](const auto &...tables) { (function(tables), ...); }, _tables);
+	}
+
+	/// @brief The tables for the different value types
+	ValueTypeTuple<DecodeTable> _tables;
+
+	/// @brief The number of bytes the payload of a read command must contain
+	std::size_t _payloadSize { 0 };
+};
+
+} // namespace xentara::plugins::templateDriver
@@ -0,0 +1,356 @@
+// Copyright (c) embedded ocean GmbH
+#include "DecodeTable.hpp"
+
+#include "ChangeDetection.hpp"
+#include "ValueConversion.hpp"
+
+#include <xentara/memory/WriteSentinel.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+
+namespace xentara::plugins::templateDriver
+{
+
+template <std::regular DataType>
+auto DecodeTable<DataType>::add(std::size_t offset, WireType wireType, PerValueReadState<DataType> &state, const Deadband &deadband)
+	-> void
+{
+	_entries.push_back({ offset, wireType, deadband, {}, {}, state._changedEvent, state });
+}
+
+template <std::regular DataType>
+auto DecodeTable<DataType>::attachInterleaved(memory::Array &dataArray, std::size_t &eventCount) -> void
+{
+	// Attach the value and the change time of each state together
+	for (auto &&entry : _entries)
+	{
+		entry._state.get().attachValue(dataArray);
+		entry._state.get().attachChangeTime(dataArray, eventCount);
+	}
+}
+
+template <std::regular DataType>
+auto DecodeTable<DataType>::attachValues(memory::Array &dataArray) -> void
+{
+	for (auto &&entry : _entries)
+	{
+		entry._state.get().attachValue(dataArray);
+	}
+}
+
+template <std::regular DataType>
+auto DecodeTable<DataType>::attachChangeTimes(memory::Array &dataArray, std::size_t &eventCount) -> void
+{
+	for (auto &&entry : _entries)
+	{
+		entry._state.get().attachChangeTime(dataArray, eventCount);
+	}
+}
+
+template <std::regular DataType>
+auto DecodeTable<DataType>::finishAttaching(ValueLayout layout) -> void
+{
+	_layout = layout;
+
+	// Copy the handles into the entries
+	for (auto &&entry : _entries)
+	{
+		entry._valueHandle = entry._state.get()._valueHandle;
+		entry._changeTimeHandle = entry._state.get()._changeTimeHandle;
+	}
+
+	// Preallocate the buffer for the change flags
+	_changed.resize(_layout == ValueLayout::Contiguous ? _entries.size() : 0);
+
+	// Check if we need to apply any deadbands
+	if constexpr (kSupportsDeadband)
+	{
+		_hasDeadbands = std::ranges::any_of(_entries, [](const Entry &entry) { return bool(entry._deadband); });
+	}
+
+	// Collect the deadbands for the vectorized change detection, if there are any
+	_absoluteDeadbands.clear();
+	_relativeDeadbands.clear();
+	if (std::same_as<DataType, double> && _layout == ValueLayout::Contiguous && _hasDeadbands)
+	{
+		_absoluteDeadbands.reserve(_entries.size());
+		_relativeDeadbands.reserve(_entries.size());
+		for (auto &&entry : _entries)
+		{
+			_absoluteDeadbands.push_back(entry._deadband._absolute);
+			_relativeDeadbands.push_back(entry._deadband._relative);
+		}
+	}
+}
+
+template <std::regular DataType>
+auto DecodeTable<DataType>::appendValueRanges(std::vector<PayloadRange> &ranges) const -> void
+{
+	for (auto &&entry : _entries)
+	{
+		ranges.push_back({ entry._offset, wireSize(entry._wireType) });
+	}
+}
+
+template <std::regular DataType>
+auto DecodeTable<DataType>::update(WriteSentinel &writeSentinel,
+	std::chrono::system_clock::time_point timeStamp,
+	const utils::eh::expected<std::reference_wrapper<const ReadCommand::Payload>, std::error_code> &payloadOrError,
+	const CommonReadState::Changes &commonChanges,
+	PendingEventList &eventsToRaise) -> void
+{
+	// Use the vectorized code for contiguous states, if possible
+	if (_layout == ValueLayout::Contiguous &&
+		updateContiguous(writeSentinel, timeStamp, payloadOrError, commonChanges, eventsToRaise))
+	{
+		return;
+	}
+
+	updateEach(writeSentinel, timeStamp, payloadOrError, commonChanges, eventsToRaise);
+}
+
+template <std::regular DataType>
+auto DecodeTable<DataType>::keep(WriteSentinel &writeSentinel) const noexcept -> void
+{
+	// Copy the old values and change times
+	const auto &oldData = writeSentinel.oldValues();
+	for (auto &&entry : _entries)
+	{
+		writeSentinel[entry._valueHandle] = oldData[entry._valueHandle];
+		writeSentinel[entry._changeTimeHandle] = oldData[entry._changeTimeHandle];
+	}
+}
+
+template <std::regular DataType>
+auto DecodeTable<DataType>::updateEach(WriteSentinel &writeSentinel,
+	std::chrono::system_clock::time_point timeStamp,
+	const utils::eh::expected<std::reference_wrapper<const ReadCommand::Payload>, std::error_code> &payloadOrError,
+	const CommonReadState::Changes &commonChanges,
+	PendingEventList &eventsToRaise) const -> void
+{
+	// Check if we have a valid payload
+	if (payloadOrError)
+	{
+		const auto &payload = payloadOrError->get();
+
+		// Decode all the values directly from the received data
+		for (auto &&entry : _entries)
+		{
+			auto value = decode(payload, entry._offset, entry._wireType);
+
+			// Suppress insignificant changes by keeping the old value. We don't do this if the common state changed,
+			// so that the first value after an error is always accurate.
+			if constexpr (kSupportsDeadband)
+			{
+				if (entry._deadband && !commonChanges)
+				{
+					const auto oldValue = writeSentinel.oldValues()[entry._valueHandle]._value;
+					if (!entry._deadband.significant(double(value), double(oldValue)))
+					{
+						value = oldValue;
+					}
+				}
+			}
+
+			State::update(writeSentinel,
+				entry._valueHandle,
+				entry._changeTimeHandle,
+				entry._changedEvent,
+				timeStamp,
+				value,
+				commonChanges,
+				eventsToRaise);
+		}
+	}
+	// We have an error
+	else
+	{
+		// Update all the states with the error
+		const utils::eh::unexpected error { payloadOrError.error() };
+		for (auto &&entry : _entries)
+		{
+			State::update(writeSentinel,
+				entry._valueHandle,
+				entry._changeTimeHandle,
+				entry._changedEvent,
+				timeStamp,
+				error,
+				commonChanges,
+				eventsToRaise);
+		}
+	}
+}
+
+template <std::regular DataType>
+auto DecodeTable<DataType>::updateContiguous(WriteSentinel &writeSentinel,
+	std::chrono::system_clock::time_point timeStamp,
+	const utils::eh::expected<std::reference_wrapper<const ReadCommand::Payload>, std::error_code> &payloadOrError,
+	const CommonReadState::Changes &commonChanges,
+	PendingEventList &eventsToRaise) -> bool
+{
+	// Nothing to do if there are no entries
+	const auto count = _entries.size();
+	if (count == 0)
+	{
+		return true;
+	}
+
+	// Get the first and last values and change times
+	const auto &first = _entries.front();
+	const auto &last = _entries.back();
+	auto *values = &writeSentinel[first._valueHandle]._value;
+	auto *changeTimes = &writeSentinel[first._changeTimeHandle]._changeTime;
+
+	// Make sure the data array really placed the elements next to each other. This is only the case if the array does not
+	// insert any padding, which it has no reason to, as the elements are naturally aligned.
+	if (&writeSentinel[last._valueHandle]._value != values + (count - 1) ||
+		&writeSentinel[last._changeTimeHandle]._changeTime != changeTimes + (count - 1)) [[unlikely]]
+	{
+		return false;
+	}
+
+	// Get the old values and change times, which have the same layout
+	const auto &oldData = writeSentinel.oldValues();
+	const std::span oldValues { &oldData[first._valueHandle]._value, count };
+	const std::span oldChangeTimes { &oldData[first._changeTimeHandle]._changeTime, count };
+
+	// Check if we have a valid payload
+	if (payloadOrError)
+	{
+		const auto &payload = payloadOrError->get();
+
+		// Decode all the values directly from the received data into the data block
+		for (std::size_t index = 0; index < count; ++index)
+		{
+			const auto &entry = _entries[index];
+			values[index] = decode(payload, entry._offset, entry._wireType);
+		}
+	}
+	// We have an error
+	else
+	{
+		// Replace the values with default constructed ones
+		std::fill_n(values, count, DataType());
+	}
+
+	// If the common state changed, everything changed
+	if (commonChanges)
+	{
+		std::fill_n(changeTimes, count, timeStamp);
+		for (auto &&entry : _entries)
+		{
+			eventsToRaise.push_back(entry._changedEvent);
+		}
+
+		return true;
+	}
+
+	// Detect the changes. Deadbands only apply to valid values, so that values are always reset correctly on error.
+	const auto changeCount =
+		detectContiguousChanges(values, oldValues, changeTimes, oldChangeTimes, timeStamp, payloadOrError && _hasDeadbands);
+
+	// Cause the correct events to be raised
+	if (changeCount > 0)
+	{
+		for (std::size_t index = 0; index < count; ++index)
+		{
+			if (_changed[index])
+			{
+				eventsToRaise.push_back(_entries[index]._changedEvent);
+			}
+		}
+	}
+
+	return true;
+}
+
+template <std::regular DataType>
+auto DecodeTable<DataType>::detectContiguousChanges(DataType *values,
+	std::span<const DataType> oldValues,
+	std::chrono::system_clock::time_point *changeTimes,
+	std::span<const std::chrono::system_clock::time_point> oldChangeTimes,
+	std::chrono::system_clock::time_point timeStamp,
+	bool applyDeadbands) noexcept -> std::size_t
+{
+	const auto count = _entries.size();
+
+	// Use the vectorized kernels for doubles
+	if constexpr (std::same_as<DataType, double>)
+	{
+		if (applyDeadbands)
+		{
+			return detectSignificantChanges({ values, count },
+				oldValues,
+				_absoluteDeadbands,
+				_relativeDeadbands,
+				{ changeTimes, count },
+				oldChangeTimes,
+				timeStamp,
+				_changed);
+		}
+	}
+	// Apply the deadbands separately for other types
+	else if constexpr (kSupportsDeadband)
+	{
+		if (applyDeadbands)
+		{
+			for (std::size_t index = 0; index < count; ++index)
+			{
+				const auto &deadband = _entries[index]._deadband;
+				if (deadband && !deadband.significant(double(values[index]), double(oldValues[index])))
+				{
+					values[index] = oldValues[index];
+				}
+			}
+		}
+	}
+
+	return detectChanges(std::span<const DataType> { values, count }, oldValues, { changeTimes, count }, oldChangeTimes, timeStamp, _changed);
+}
+
+template <std::regular DataType>
+auto DecodeTable<DataType>::decode(const ReadCommand::Payload &payload, std::size_t offset, WireType wireType) noexcept -> DataType
+{
+	switch (wireType)
+	{
+	case WireType::Int8:
+		return convertValue<DataType>(payload.decode<std::int8_t>(offset));
+	case WireType::UInt8:
+		return convertValue<DataType>(payload.decode<std::uint8_t>(offset));
+	case WireType::Int16:
+		return convertValue<DataType>(payload.decode<std::int16_t>(offset));
+	case WireType::UInt16:
+		return convertValue<DataType>(payload.decode<std::uint16_t>(offset));
+	case WireType::Int32:
+		return convertValue<DataType>(payload.decode<std::int32_t>(offset));
+	case WireType::UInt32:
+		return convertValue<DataType>(payload.decode<std::uint32_t>(offset));
+	case WireType::Int64:
+		return convertValue<DataType>(payload.decode<std::int64_t>(offset));
+	case WireType::UInt64:
+		return convertValue<DataType>(payload.decode<std::uint64_t>(offset));
+	case WireType::Float32:
+		return convertValue<DataType>(payload.decode<float>(offset));
+	case WireType::Float64:
+	default:
+		return convertValue<DataType>(payload.decode<double>(offset));
+	}
+}
+
+/// @class xentara::plugins::templateDriver::DecodeTable
+/// @todo add template instantiations for other supported types
+template class DecodeTable<double>;
+template class DecodeTable<float>;
+template class DecodeTable<bool>;
+template class DecodeTable<std::int8_t>;
+template class DecodeTable<std::uint8_t>;
+template class DecodeTable<std::int16_t>;
+template class DecodeTable<std::uint16_t>;
+template class DecodeTable<std::int32_t>;
+template class DecodeTable<std::uint32_t>;
+template class DecodeTable<std::int64_t>;
+template class DecodeTable<std::uint64_t>;
+
+} // namespace xentara::plugins::templateDriver
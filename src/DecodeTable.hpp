@@ -0,0 +1,182 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include "Types.hpp"
+#include "CommonReadState.hpp"
+#include "Deadband.hpp"
+#include "PerValueReadState.hpp"
+#include "ReadCommand.hpp"
+#include "WireType.hpp"
+
+#include <xentara/memory/Array.hpp>
+#include <xentara/process/Event.hpp>
+#include <xentara/utils/eh/expected.hpp>
+
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+namespace xentara::plugins::templateDriver
+{
+
+/// @brief The layout of the value states within the data block of an I/O transaction
+enum class ValueLayout
+{
+	/// @brief The value and change time of each state are stored next to each other
+	Interleaved,
+	/// @brief The values of all states of the same type are stored contiguously, followed by the change times of all those states.
+	///
+	/// This layout allows changes to be detected using vector instructions.
+	Contiguous
+};
+
+/// @brief A range of bytes within the payload of a read command
+struct PayloadRange final
+{
+	/// @brief The offset of the range, in bytes
+	std::size_t _offset;
+	/// @brief The size of the range, in bytes
+	std::size_t _size;
+};
+
+/// @brief The part of a decode plan that decodes all the values of a single type.
+///
+/// The decode plan contains one table for each supported value type, so that decoding and change detection are
+/// specialized for each type at compile time, and the values are stored in the data block using their native type.
+template <std::regular DataType>
+class DecodeTable final
+{
+public:
+	/// @brief Adds an entry to the table
+	/// @param offset The offset of the value within the payload of a read command, in bytes
+	/// @param wireType The encoding of the value within the payload
+	/// @param state The state to store the value in
+	/// @param deadband The deadband used to suppress insignificant changes of the value. This is ignored for boolean values.
+	auto add(std::size_t offset, WireType wireType, PerValueReadState<DataType> &state, const Deadband &deadband) -> void;
+
+	/// @brief Attaches the value and change time of each state, interleaved
+	auto attachInterleaved(memory::Array &dataArray, std::size_t &eventCount) -> void;
+	/// @brief Attaches the values of all the states contiguously
+	auto attachValues(memory::Array &dataArray) -> void;
+	/// @brief Attaches the change times of all the states contiguously
+	auto attachChangeTimes(memory::Array &dataArray, std::size_t &eventCount) -> void;
+	/// @brief Prepares the table for updating once all the states have been attached
+	/// @param layout The layout that was used to attach the states
+	auto finishAttaching(ValueLayout layout) -> void;
+
+	/// @brief Appends the byte ranges of all the values to a list
+	auto appendValueRanges(std::vector<PayloadRange> &ranges) const -> void;
+
+	/// @brief Updates the states of all the entries and collects the events to send
+	/// @param writeSentinel A write sentinel for the data block the data is stored in
+	/// @param timeStamp The update time stamp
+	/// @param payloadOrError This is a variant-like type that will hold either the payload of the read command, or an std::error_code object
+	/// containing a read error.
+	/// @param commonChanges An object containing information about which parts of the common read state changed, if any.
+	/// @param eventsToRaise Any events that need to be raised as a result of the update will be added to this list.
+	auto update(WriteSentinel &writeSentinel,
+		std::chrono::system_clock::time_point timeStamp,
+		const utils::eh::expected<std::reference_wrapper<const ReadCommand::Payload>, std::error_code> &payloadOrError,
+		const CommonReadState::Changes &commonChanges,
+		PendingEventList &eventsToRaise) -> void;
+
+	/// @brief Keeps the states of all the entries unchanged
+	/// @param writeSentinel A write sentinel for the data block the data is stored in
+	auto keep(WriteSentinel &writeSentinel) const noexcept -> void;
+
+	/// @brief Decodes a single value from the payload
+	/// @param payload The payload of the read command
+	/// @param offset The offset of the value within the payload, in bytes
+	/// @param wireType The encoding of the value within the payload
+	static auto decode(const ReadCommand::Payload &payload, std::size_t offset, WireType wireType) noexcept -> DataType;
+
+private:
+	/// @brief The state type
+	using State = PerValueReadState<DataType>;
+
+	/// @brief Whether deadbands apply to the data type
+	static constexpr bool kSupportsDeadband = std::is_arithmetic_v<DataType> && !std::same_as<DataType, bool>;
+
+	/// @brief An entry in the table
+	struct Entry final
+	{
+		/// @brief The offset of the value within the payload, in bytes
+		std::size_t _offset;
+		/// @brief The encoding of the value within the payload
+		WireType _wireType;
+		/// @brief The deadband used to suppress insignificant changes
+		Deadband _deadband;
+		/// @brief The array element that contains the value
+		memory::Array::ObjectHandle<typename State::Value> _valueHandle;
+		/// @brief The array element that contains the change time
+		memory::Array::ObjectHandle<typename State::ChangeTime> _changeTimeHandle;
+		/// @brief The event to raise when the state changes
+		std::reference_wrapper<process::Event> _changedEvent;
+		/// @brief The state the handles belong to. This is only used when attaching the states.
+		std::reference_wrapper<State> _state;
+	};
+
+	/// @brief Updates the states one by one
+	auto updateEach(WriteSentinel &writeSentinel,
+		std::chrono::system_clock::time_point timeStamp,
+		const utils::eh::expected<std::reference_wrapper<const ReadCommand::Payload>, std::error_code> &payloadOrError,
+		const CommonReadState::Changes &commonChanges,
+		PendingEventList &eventsToRaise) const -> void;
+
+	/// @brief Updates the states all at once, if they are stored contiguously
+	/// @return Returns *false* if the states are not actually contiguous in the data block, and nothing was updated.
+	auto updateContiguous(WriteSentinel &writeSentinel,
+		std::chrono::system_clock::time_point timeStamp,
+		const utils::eh::expected<std::reference_wrapper<const ReadCommand::Payload>, std::error_code> &payloadOrError,
+		const CommonReadState::Changes &commonChanges,
+		PendingEventList &eventsToRaise) -> bool;
+
+	/// @brief Detects the changes of contiguous values, applying the deadbands if requested
+	auto detectContiguousChanges(DataType *values,
+		std::span<const DataType> oldValues,
+		std::chrono::system_clock::time_point *changeTimes,
+		std::span<const std::chrono::system_clock::time_point> oldChangeTimes,
+		std::chrono::system_clock::time_point timeStamp,
+		bool applyDeadbands) noexcept -> std::size_t;
+
+	/// @brief The entries
+	std::vector<Entry> _entries;
+
+	/// @brief The layout of the states
+	ValueLayout _layout { ValueLayout::Interleaved };
+
+	/// @brief Whether any of the entries has a deadband
+	bool _hasDeadbands { false };
+
+	/// @brief Preallocated buffer receiving the change flags from the change detection.
+	std::vector<std::uint8_t> _changed;
+
+	/// @brief The absolute deadbands of all entries, for the vectorized change detection of doubles.
+	/// This is empty if the layout is not contiguous, or if none of the entries has a deadband.
+	std::vector<double> _absoluteDeadbands;
+	/// @brief The relative deadbands of all entries, for the vectorized change detection of doubles.
+	/// This is empty if the layout is not contiguous, or if none of the entries has a deadband.
+	std::vector<double> _relativeDeadbands;
+};
+
+/// @class xentara::plugins::templateDriver::DecodeTable
+/// @todo add extern template statements for other supported types
+extern template class DecodeTable<double>;
+extern template class DecodeTable<float>;
+extern template class DecodeTable<bool>;
+extern template class DecodeTable<std::int8_t>;
+extern template class DecodeTable<std::uint8_t>;
+extern template class DecodeTable<std::int16_t>;
+extern template class DecodeTable<std::uint16_t>;
+extern template class DecodeTable<std::int32_t>;
+extern template class DecodeTable<std::uint32_t>;
+extern template class DecodeTable<std::int64_t>;
+extern template class DecodeTable<std::uint64_t>;
+
+} // namespace xentara::plugins::templateDriver
@@ -0,0 +1,102 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include <xentara/utils/tools/Unique.hpp>
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace xentara::plugins::templateDriver
+{
+
+/// @brief A thread-safe, lock-free set of flags that marks which of a fixed number of objects have changed.
+///
+/// Any thread can mark objects, and a single consumer thread can visit and clear all the marked objects. Only the words
+/// that actually contain marks are modified by the consumer, so that visiting a large, mostly clean bitmap is cheap.
+class DirtyBitmap final : private utils::tools::Unique
+{
+public:
+	/// @brief Allocates the bitmap, with all objects unmarked.
+	/// @param size The number of objects
+	auto reset(std::size_t size) -> void
+	{
+		_wordCount = (size + kWordBits - 1) / kWordBits;
+		_words = std::make_unique<std::atomic<Word>[]>(_wordCount);
+		_size = size;
+	}
+
+	/// @brief Gets the number of objects
+	auto size() const noexcept -> std::size_t
+	{
+		return _size;
+	}
+
+	/// @brief Checks whether any objects are marked
+	auto any() const noexcept -> bool
+	{
+		for (std::size_t wordIndex = 0; wordIndex < _wordCount; ++wordIndex)
+		{
+			if (_words[wordIndex].load(std::memory_order_relaxed) != 0)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	/// @brief Marks an object.
+	///
+	/// Any data the caller has written before marking the object will be visible to the thread that visits it.
+	/// @param index The index of the object. Indices outside the bitmap are ignored.
+	auto mark(std::size_t index) noexcept -> void
+	{
+		if (index >= _size) [[unlikely]]
+		{
+			return;
+		}
+
+		_words[index / kWordBits].fetch_or(Word(1) << (index % kWordBits), std::memory_order_release);
+	}
+
+	/// @brief Clears all marks, and calls a function for each object that was marked, in ascending order.
+	///
+	/// Objects marked while this function is running are either visited now or left marked for the next call.
+	/// @param function The function to call with the index of each marked object
+	template <typename Function>
+	auto consume(Function &&function) -> void
+	{
+		for (std::size_t wordIndex = 0; wordIndex < _wordCount; ++wordIndex)
+		{
+			auto &word = _words[wordIndex];
+			// Check before exchanging to avoid needlessly taking ownership of cache lines that contain no marks
+			if (word.load(std::memory_order_relaxed) == 0)
+			{
+				continue;
+			}
+
+			for (auto bits = word.exchange(0, std::memory_order_acquire); bits != 0; bits &= bits - 1)
+			{
+				function(wordIndex * kWordBits + std::size_t(std::countr_zero(bits)));
+			}
+		}
+	}
+
+private:
+	/// @brief The type used to hold the marks
+	using Word = std::uint64_t;
+	/// @brief The number of marks in a word
+	static constexpr std::size_t kWordBits = 64;
+
+	/// @brief The words that hold the marks
+	std::unique_ptr<std::atomic<Word>[]> _words;
+	/// @brief The number of words
+	std::size_t _wordCount { 0 };
+	/// @brief The number of objects
+	std::size_t _size { 0 };
+};
+
+} // namespace xentara::plugins::templateDriver
@@ -0,0 +1,35 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include <xentara/utils/tools/Unique.hpp>
+
+namespace xentara::plugins::templateDriver
+{
+
+/// @brief A handle used to access the I/O component
+///
+/// This is defined outside of TemplateIoComponent, so that helpers like the read coalescer, which the I/O component
+/// contains, can be handed a handle to send their requests on.
+/// @todo implement a proper handle
+class IoComponentHandle final : private utils::tools::Unique
+{
+public:
+	/// @brief Destructor. Closes the connection.
+	///
+	/// The handle is shared by the connection pool and the requests that are using it, so this may be called on any thread
+	/// that returns the last lease after the pool has dropped the handle.
+	~IoComponentHandle()
+	{
+		/// @todo close the connection if it is open, ignoring any errors. If the disconnect function can throw exceptions,
+		// these should be caught and ignored.
+	}
+
+	/// @brief determines of the I/O component is connected
+	explicit operator bool() const noexcept
+	{
+		/// @todo return the actual state
+		return false;
+	}
+};
+
+} // namespace xentara::plugins::templateDriver
@@ -0,0 +1,111 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include "RingQueue.hpp"
+#include "SingleValueQueue.hpp"
+
+#include <concepts>
+#include <cstddef>
+#include <optional>
+#include <utility>
+#include <variant>
+
+namespace xentara::plugins::templateDriver
+{
+
+/// @brief The queue that holds the values scheduled for an output.
+///
+/// Depending on the configuration, this either holds only the last scheduled value, or a bounded number of values
+/// that are all written in order.
+template <typename DataType>
+class OutputQueue final
+{
+public:
+	/// @brief Constructor
+	/// @param capacity The number of values to hold, or 0 to only keep the last value.
+	explicit OutputQueue(std::size_t capacity = 0)
+	{
+		if (capacity > 0)
+		{
+			_queue.template emplace<RingQueue<DataType>>(capacity);
+		}
+	}
+
+	/// @brief Gets the maximum number of values dequeueBatch() removes at once
+	auto batchSize() const noexcept -> std::size_t
+	{
+		if (const auto ringQueue = std::get_if<RingQueue<DataType>>(&_queue))
+		{
+			return ringQueue->capacity();
+		}
+
+		return 1;
+	}
+
+	/// @brief Enqueues a value.
+	/// @param value The value to place in the queue
+	/// @return Returns *false* if the queue holds multiple values and is full, and the value was not enqueued.
+	auto enqueue(const DataType &value) noexcept -> bool
+	{
+		return std::visit(
+			[&]<typename Queue>(Queue &queue) {
+				if constexpr (std::same_as<Queue, SingleValueQueue<DataType>>)
+				{
+					queue.enqueue(value);
+					return true;
+				}
+				else
+				{
+					return queue.enqueue(value);
+				}
+			},
+			_queue);
+	}
+
+	/// @brief Removes the pending values from the queue in the order they were enqueued
+	///
+	/// At most as many values as the queue can hold are removed, so that producers cannot keep the caller busy forever.
+	/// @param function The function to call for each value
+	/// @param morePending This is set to *true* if the batch limit was reached, so that more values may still be pending.
+	/// @return The number of values that were removed
+	template <typename Function>
+	auto dequeueBatch(Function &&function, bool &morePending) -> std::size_t
+	{
+		morePending = false;
+		return std::visit(
+			[&]<typename Queue>(Queue &queue) -> std::size_t {
+				if constexpr (std::same_as<Queue, SingleValueQueue<DataType>>)
+				{
+					auto value = queue.dequeue();
+					if (!value)
+					{
+						return 0;
+					}
+					function(*value);
+					return 1;
+				}
+				else
+				{
+					std::size_t count = 0;
+					for (; count < queue.capacity(); ++count)
+					{
+						auto value = queue.dequeue();
+						if (!value)
+						{
+							break;
+						}
+						function(*value);
+					}
+					morePending = count == queue.capacity();
+					return count;
+				}
+			},
+			_queue);
+	}
+
+private:
+	/// @brief The actual queue
+	std::variant<SingleValueQueue<DataType>, RingQueue<DataType>> _queue;
+};
+
+} // namespace xentara::plugins::templateDriver
@@ -5,6 +5,8 @@
 
 #include <xentara/memory/WriteSentinel.hpp>
 
+#include <cstdint>
+
 namespace xentara::plugins::templateDriver
 {
 
@@ -31,7 +33,7 @@ auto PerValueReadState<DataType>::makeReadHandle(const DataBlock &dataBlock,
 	// Try each readable attribute
 	if (attribute == model::Attribute::kChangeTime)
 	{
-		return dataBlock.member(_stateHandle, &State::_changeTime);
+		return dataBlock.member(_changeTimeHandle, &ChangeTime::_changeTime);
 	}
 
 	return std::nullopt;
@@ -40,14 +42,21 @@ auto PerValueReadState<DataType>::makeReadHandle(const DataBlock &dataBlock,
 template <std::regular DataType>
 auto PerValueReadState<DataType>::valueReadHandle(const DataBlock &dataBlock) const noexcept -> data::ReadHandle
 {
-	return dataBlock.member(_stateHandle, &State::_value);
+	return dataBlock.member(_valueHandle, &Value::_value);
+}
+
+template <std::regular DataType>
+auto PerValueReadState<DataType>::attachValue(memory::Array &dataArray) -> void
+{
+	// Add the value to the array
+	_valueHandle = dataArray.appendObject<Value>();
 }
 
 template <std::regular DataType>
-auto PerValueReadState<DataType>::attach(memory::Array &dataArray, std::size_t &eventCount) -> void
+auto PerValueReadState<DataType>::attachChangeTime(memory::Array &dataArray, std::size_t &eventCount) -> void
 {
-	// Add the state to the array
-	_stateHandle = dataArray.appendObject<State>();
+	// Add the change time to the array
+	_changeTimeHandle = dataArray.appendObject<ChangeTime>();
 
 	// Add the number of events that can be raised at once, which is just the one event we have.
 	eventCount += 1;
@@ -61,30 +70,56 @@ auto PerValueReadState<DataType>::update(
 	const CommonReadState::Changes &commonChanges,
 	PendingEventList &eventsToRaise) -> void
 {
-	// Get the correct array entry
-	auto &state = writeSentinel[_stateHandle];
-	const auto &oldState = writeSentinel.oldValues()[_stateHandle];
+	update(writeSentinel, _valueHandle, _changeTimeHandle, _changedEvent, timeStamp, valueOrError, commonChanges, eventsToRaise);
+}
+
+template <std::regular DataType>
+auto PerValueReadState<DataType>::update(
+	WriteSentinel &writeSentinel,
+	memory::Array::ObjectHandle<Value> valueHandle,
+	memory::Array::ObjectHandle<ChangeTime> changeTimeHandle,
+	process::Event &changedEvent,
+	std::chrono::system_clock::time_point timeStamp,
+	const utils::eh::expected<DataType, std::error_code> &valueOrError,
+	const CommonReadState::Changes &commonChanges,
+	PendingEventList &eventsToRaise) -> void
+{
+	// Get the correct array entries
+	auto &value = writeSentinel[valueHandle];
+	const auto &oldValue = writeSentinel.oldValues()[valueHandle];
+	auto &changeTime = writeSentinel[changeTimeHandle];
+	const auto &oldChangeTime = writeSentinel.oldValues()[changeTimeHandle];
 
 	// Set the value, replacing errors with a default constructed value
-	state._value = valueOrError.value_or(DataType());
+	value._value = valueOrError.value_or(DataType());
 
 	// Detect changes
-	const auto valueChanged = state._value != oldState._value;
+	const auto valueChanged = value._value != oldValue._value;
 	const auto changed = valueChanged || commonChanges;
 
 	// Update the change time, if necessary. We always need to write the change time, even if it is the same as before,
 	// because memory resources use swap-in.
-	state._changeTime = changed ? timeStamp : oldState._changeTime;
+	changeTime._changeTime = changed ? timeStamp : oldChangeTime._changeTime;
 
 	// Cause the correct events to be raised
 	if (changed)
 	{
-		eventsToRaise.push_back(_changedEvent);
+		eventsToRaise.push_back(changedEvent);
 	}
 }
 
 /// @class xentara::plugins::templateDriver::PerValueReadState
 /// @todo add template instantiations for other supported types
 template class PerValueReadState<double>;
+template class PerValueReadState<float>;
+template class PerValueReadState<bool>;
+template class PerValueReadState<std::int8_t>;
+template class PerValueReadState<std::uint8_t>;
+template class PerValueReadState<std::int16_t>;
+template class PerValueReadState<std::uint16_t>;
+template class PerValueReadState<std::int32_t>;
+template class PerValueReadState<std::uint32_t>;
+template class PerValueReadState<std::int64_t>;
+template class PerValueReadState<std::uint64_t>;
 
 } // namespace xentara::plugins::templateDriver
\ No newline at end of file
@@ -15,12 +15,16 @@
 
 #include <chrono>
 #include <concepts>
+#include <cstdint>
 #include <optional>
 #include <memory>
 
 namespace xentara::plugins::templateDriver
 {
 
+template <std::regular DataType>
+class DecodeTable;
+
 /// @brief Per-value state information for a read operation.
 /// 
 /// This class contains all the read state information that is tracked separately for all the values read using the same transaction.
@@ -58,13 +62,21 @@ public:
 	/// @return A read handle to the value attribute
 	auto valueReadHandle(const DataBlock &dataBlock) const noexcept -> data::ReadHandle;
 
-	/// @brief Attaches the state to its I/O transaction
-	/// @param dataArray The data array that the attributes should be added to. The caller will use the information in this array
+	/// @brief Attaches the value to its I/O transaction
+	///
+	/// The value and the change time are attached separately, so that the caller can choose whether the values of all
+	/// the states of an I/O transaction are interleaved with the change times, or stored contiguously.
+	/// @param dataArray The data array that the value should be added to. The caller will use the information in this array
+	/// to allocate the data block.
+	auto attachValue(memory::Array &dataArray) -> void;
+
+	/// @brief Attaches the change time to its I/O transaction
+	/// @param dataArray The data array that the change time should be added to. The caller will use the information in this array
 	/// to allocate the data block.
 	/// @param eventCount A variable that counts the total number of events than can be raised for a single update.
 	/// The maximum number of events that update() will request to be raised will be added to this variable. The caller will use this
 	/// event count to preallocate a buffer when collecting the events to raise after an update.
-	auto attach(memory::Array &dataArray, std::size_t &eventCount) -> void;
+	auto attachChangeTime(memory::Array &dataArray, std::size_t &eventCount) -> void;
 
 	/// @brief Updates the data and collects the events to send
 	/// @param writeSentinel A write sentinel for the data block the data is stored in
@@ -82,24 +94,66 @@ public:
 		PendingEventList &eventsToRaise) -> void;
 
 private:
-	/// @brief This structure is used to represent the state inside the memory block
-	struct State final
+	// The decode tables need access to the state handles and the event
+	template <std::regular>
+	friend class DecodeTable;
+
+	/// @brief This structure is used to represent the value inside the memory block
+	struct Value final
 	{
 		/// @brief The current value
 		DataType _value {};
+	};
+
+	/// @brief This structure is used to represent the change time inside the memory block
+	struct ChangeTime final
+	{
 		/// @brief The change time stamp
 		std::chrono::system_clock::time_point _changeTime { std::chrono::system_clock::time_point::min() };
 	};
 
+	/// @brief Updates a state in the data block and collects the events to send
+	///
+	/// This function is used by update(), and by the decode plan, which has its own copy of the state handles and the event.
+	/// @param writeSentinel A write sentinel for the data block the data is stored in
+	/// @param valueHandle The array element that contains the value
+	/// @param changeTimeHandle The array element that contains the change time
+	/// @param changedEvent The event to raise if the state changes
+	/// @param timeStamp The update time stamp
+	/// @param valueOrError This is a variant-like type that will hold either the new value, or an std::error_code object
+	/// containing a read error.
+	/// @param commonChanges An object containing information about which parts of the common read state changed, if any.
+	/// @param eventsToRaise Any events that need to be raised as a result of the update will be added to this list.
+	static auto update(WriteSentinel &writeSentinel,
+		memory::Array::ObjectHandle<Value> valueHandle,
+		memory::Array::ObjectHandle<ChangeTime> changeTimeHandle,
+		process::Event &changedEvent,
+		std::chrono::system_clock::time_point timeStamp,
+		const utils::eh::expected<DataType, std::error_code> &valueOrError,
+		const CommonReadState::Changes &commonChanges,
+		PendingEventList &eventsToRaise) -> void;
+
 	/// @brief A summary event that is raised when anything changes
 	process::Event _changedEvent { io::Direction::Input };
 
-	/// @brief The array element that contains the state
-	memory::Array::ObjectHandle<State> _stateHandle;
+	/// @brief The array element that contains the value
+	memory::Array::ObjectHandle<Value> _valueHandle;
+	/// @brief The array element that contains the change time
+	memory::Array::ObjectHandle<ChangeTime> _changeTimeHandle;
 };
 
 /// @class xentara::plugins::templateDriver::PerValueReadState
 /// @todo add extern template statements for other supported types
 extern template class PerValueReadState<double>;
+extern template class PerValueReadState<float>;
+extern template class PerValueReadState<bool>;
+extern template class PerValueReadState<std::int8_t>;
+extern template class PerValueReadState<std::uint8_t>;
+extern template class PerValueReadState<std::int16_t>;
+extern template class PerValueReadState<std::uint16_t>;
+extern template class PerValueReadState<std::int32_t>;
+extern template class PerValueReadState<std::uint32_t>;
+extern template class PerValueReadState<std::int64_t>;
+extern template class PerValueReadState<std::uint64_t>;
 
 } // namespace xentara::plugins::templateDriver
\ No newline at end of file
@@ -0,0 +1,102 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include <xentara/utils/tools/Unique.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+namespace xentara::plugins::templateDriver
+{
+
+/// @brief A thread-safe, lock-free token bucket that limits the rate of requests sent to an I/O component.
+///
+/// The bucket is implemented using the generic cell rate algorithm, which only needs to keep track of a single time stamp:
+/// the theoretical arrival time of the next request if requests were sent at exactly the maximum rate. A request conforms
+/// if it does not arrive earlier than that, minus the tolerance that allows for bursts.
+class RateLimiter final : private utils::tools::Unique
+{
+public:
+	/// @brief Sets the rate
+	/// @param rate The maximum sustained number of requests per second, or 0 for no limit
+	/// @param burst The maximum number of requests that can be sent at once. Must be at least 1.
+	auto configure(double rate, std::size_t burst) -> void
+	{
+		if (rate <= 0)
+		{
+			_emissionInterval = Duration::zero();
+			return;
+		}
+
+		_emissionInterval = std::chrono::duration_cast<Duration>(std::chrono::duration<double>(1.0 / rate));
+		_burstTolerance = _emissionInterval * (std::max<std::size_t>(burst, 1) - 1);
+	}
+
+	/// @brief Checks whether a rate limit was configured
+	auto enabled() const noexcept -> bool
+	{
+		return _emissionInterval != Duration::zero();
+	}
+
+	/// @brief Takes a single token from the bucket, if one is available
+	/// @param timeStamp The current time
+	/// @return Returns *true* if the request may be sent, or *false* if it must be deferred.
+	auto tryAcquire(std::chrono::system_clock::time_point timeStamp) noexcept -> bool
+	{
+		if (!enabled())
+		{
+			return true;
+		}
+
+		const auto now = timeStamp.time_since_epoch().count();
+		auto arrivalTime = _arrivalTime.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			const auto earliest = std::max(arrivalTime, now);
+			if (earliest - _burstTolerance.count() > now)
+			{
+				return false;
+			}
+			if (_arrivalTime.compare_exchange_weak(arrivalTime, earliest + _emissionInterval.count(), std::memory_order_relaxed))
+			{
+				return true;
+			}
+		}
+	}
+
+	/// @brief Takes tokens from the bucket unconditionally.
+	///
+	/// This is used for requests that could not be known in advance. The bucket may go into debt, which delays subsequent requests.
+	/// @param timeStamp The current time
+	/// @param count The number of tokens to take
+	auto charge(std::chrono::system_clock::time_point timeStamp, std::size_t count) noexcept -> void
+	{
+		if (!enabled() || count == 0)
+		{
+			return;
+		}
+
+		const auto now = timeStamp.time_since_epoch().count();
+		auto arrivalTime = _arrivalTime.load(std::memory_order_relaxed);
+		while (!_arrivalTime.compare_exchange_weak(
+			arrivalTime, std::max(arrivalTime, now) + _emissionInterval.count() * Duration::rep(count), std::memory_order_relaxed))
+		{
+		}
+	}
+
+private:
+	/// @brief The duration type used
+	using Duration = std::chrono::system_clock::duration;
+
+	/// @brief The time between two requests at the maximum rate, or 0 for no limit
+	Duration _emissionInterval { Duration::zero() };
+	/// @brief How far ahead of the theoretical arrival time a request may arrive
+	Duration _burstTolerance { Duration::zero() };
+
+	/// @brief The theoretical arrival time of the next request, in ticks since the epoch of the system clock
+	std::atomic<Duration::rep> _arrivalTime { 0 };
+};
+
+} // namespace xentara::plugins::templateDriver
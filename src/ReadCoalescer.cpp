@@ -0,0 +1,191 @@
+// Copyright (c) embedded ocean GmbH
+#include "ReadCoalescer.hpp"
+
+#include <xentara/utils/eh/currentErrorCode.hpp>
+
+#include <algorithm>
+#include <iterator>
+
+namespace xentara::plugins::templateDriver
+{
+
+auto ReadCoalescer::addClient(std::reference_wrapper<Client> client) -> void
+{
+	_clients.push_back(client);
+	_requestedClients.reserve(_clients.size());
+
+	// Make room for the read commands of the new client, in case none of them can be merged
+	_mergedRanges.reserve(_mergedRanges.capacity() + client.get().coalescedReadCommands().size());
+
+	// Make sure there is a receive buffer for the payload of the new client
+	regroup();
+}
+
+auto ReadCoalescer::regroup() -> void
+{
+	// Collect the address ranges of the payloads of all the clients
+	std::vector<AddressRange> extents;
+	extents.reserve(_clients.size());
+	for (auto &&client : _clients)
+	{
+		extents.push_back({ client.get().coalescedBaseAddress(), client.get().coalescedPayloadSize() });
+	}
+	std::ranges::sort(extents, {}, &AddressRange::_address);
+
+	// Make one group for each run of overlapping or touching payloads
+	_bufferGroups.clear();
+	std::size_t groupEnd { 0 };
+	for (auto &&extent : extents)
+	{
+		const auto extentEnd = extent._address + extent._size;
+		if (!_bufferGroups.empty() && extent._address <= groupEnd)
+		{
+			groupEnd = std::max(groupEnd, extentEnd);
+		}
+		else
+		{
+			// Size the previous group before starting a new one
+			if (!_bufferGroups.empty())
+			{
+				auto &last = _bufferGroups.back();
+				last._receiveBuffer.resize(groupEnd - last._origin);
+			}
+			_bufferGroups.push_back({ extent._address, {} });
+			groupEnd = extentEnd;
+		}
+	}
+	if (!_bufferGroups.empty())
+	{
+		auto &last = _bufferGroups.back();
+		last._receiveBuffer.resize(groupEnd - last._origin);
+	}
+}
+
+auto ReadCoalescer::bufferGroup(std::size_t address) noexcept -> BufferGroup &
+{
+	// The groups are sorted and disjoint, so the address belongs to the last group that starts at or before it
+	const auto next = std::ranges::upper_bound(_bufferGroups, address, {}, &BufferGroup::_origin);
+	return *std::prev(next);
+}
+
+auto ReadCoalescer::read(const IoComponentHandle &handle, std::chrono::system_clock::time_point timeStamp, std::size_t maxPduSize)
+	-> void
+{
+	// Find out who wants to be read
+	collectRequests();
+	if (_requestedClients.empty())
+	{
+		return;
+	}
+
+	// Merge the ranges the clients need into as few commands as possible
+	mergeRanges(maxPduSize);
+
+	try
+	{
+		// Send the merged read commands back to back
+		/// @todo if the protocol allows pipelining, send all the commands before receiving any responses
+		for (auto &&range : _mergedRanges)
+		{
+			// Make a read command that receives the data at the correct position in the receive buffer of its group
+			/// @todo construct the command using the device address range._address
+			auto &group = bufferGroup(range._address);
+			const ReadCommand command { range._address - group._origin, range._size };
+			const auto responseBuffer = command.responseBuffer(group._receiveBuffer);
+
+			/// @todo send the read command using handle and receive the response directly into responseBuffer, and set responseSize to the
+			// number of bytes actually received.
+			std::size_t responseSize = responseBuffer.size();
+
+			/// @todo if the read function does not throw errors, but uses return types or internal handle state,
+			// throw an std::system_error here on failure.
+
+			// Make sure we received enough data
+			if (const auto error = command.validateResponse(responseSize))
+			{
+				throw std::system_error(error);
+			}
+		}
+	}
+	catch (const std::exception &)
+	{
+		// Get the error from the current exception using this special utility function
+		const auto error = utils::eh::currentErrorCode();
+
+		// Hand the error to all the clients
+		for (auto &&client : _requestedClients)
+		{
+			client.get().coalescedReadCompleted(timeStamp, utils::eh::unexpected(error));
+		}
+
+		return;
+	}
+
+	// Hand each client its part of the receive buffer of its group
+	for (auto &&client : _requestedClients)
+	{
+		const auto baseAddress = client.get().coalescedBaseAddress();
+		const auto &group = bufferGroup(baseAddress);
+		const ReadCommand::Payload payload { std::span<const std::byte>(group._receiveBuffer).subspan(
+			baseAddress - group._origin, client.get().coalescedPayloadSize()) };
+		client.get().coalescedReadCompleted(timeStamp, payload);
+	}
+}
+
+auto ReadCoalescer::discardRequests() noexcept -> void
+{
+	for (auto &&client : _clients)
+	{
+		client.get()._readRequested.store(false, std::memory_order_relaxed);
+	}
+}
+
+auto ReadCoalescer::collectRequests() noexcept -> void
+{
+	// This does not allocate, because the vector was reserved in addClient()
+	_requestedClients.clear();
+	for (auto &&client : _clients)
+	{
+		if (client.get()._readRequested.exchange(false, std::memory_order_acq_rel))
+		{
+			_requestedClients.push_back(client);
+		}
+	}
+}
+
+auto ReadCoalescer::mergeRanges(std::size_t maxPduSize) -> void
+{
+	// Collect the address ranges of all the read commands of all the clients
+	_mergedRanges.clear();
+	for (auto &&client : _requestedClients)
+	{
+		const auto baseAddress = client.get().coalescedBaseAddress();
+		for (auto &&command : client.get().coalescedReadCommands())
+		{
+			_mergedRanges.push_back({ baseAddress + command->offset(), command->size() });
+		}
+	}
+	std::ranges::sort(_mergedRanges, {}, &AddressRange::_address);
+
+	// Merge overlapping and adjacent ranges in place, as long as the result still fits into a single PDU
+	std::size_t mergedCount { 0 };
+	for (auto &&range : _mergedRanges)
+	{
+		if (mergedCount > 0)
+		{
+			auto &last = _mergedRanges[mergedCount - 1];
+			const auto lastEnd = last._address + last._size;
+			const auto end = std::max(lastEnd, range._address + range._size);
+			if (range._address <= lastEnd && (maxPduSize == 0 || end - last._address <= maxPduSize))
+			{
+				last._size = end - last._address;
+				continue;
+			}
+		}
+
+		_mergedRanges[mergedCount++] = range;
+	}
+	_mergedRanges.resize(mergedCount);
+}
+
+} // namespace xentara::plugins::templateDriver
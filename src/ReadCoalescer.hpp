@@ -0,0 +1,142 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include "IoComponentHandle.hpp"
+#include "ReadCommand.hpp"
+
+#include <xentara/utils/eh/expected.hpp>
+#include <xentara/utils/tools/Unique.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <span>
+#include <system_error>
+#include <vector>
+
+namespace xentara::plugins::templateDriver
+{
+
+/// @brief Merges the reads of several I/O transactions into a minimal set of read commands.
+///
+/// I/O transactions that take part in coalescing do not read the data themselves. Instead, their read tasks request
+/// a read using requestRead(), and the I/O component performs all the requested reads at once in its own read task.
+/// The address ranges of all the requesting transactions are merged into as few contiguous read commands as possible,
+/// and the results are handed back to each of the transactions.
+/// @note The read task of the I/O component must be scheduled after the read tasks of the I/O transactions in the same pipeline,
+/// so that it can pick up the requests made in the same cycle.
+class ReadCoalescer final : private utils::tools::Unique
+{
+public:
+	/// @brief Interface for I/O transactions that take part in read coalescing
+	class Client
+	{
+	public:
+		/// @brief Virtual destructor
+		/// @note The destructor is pure virtual (= 0) to ensure that this class will remain abstract, even if we should remove all
+		/// other pure virtual functions later. This is not necessary, of course, but prevents the abstract class from becoming
+		/// instantiable by accident as a result of refactoring.
+		virtual ~Client() = 0;
+
+		/// @brief Gets the device address of the first byte of the payload
+		virtual auto coalescedBaseAddress() const noexcept -> std::size_t = 0;
+
+		/// @brief Gets the size of the payload, in bytes
+		virtual auto coalescedPayloadSize() const noexcept -> std::size_t = 0;
+
+		/// @brief Gets the read commands the transaction would use if it read the data itself.
+		///
+		/// The offsets of the commands are relative to the base address.
+		virtual auto coalescedReadCommands() const noexcept -> std::span<const std::unique_ptr<ReadCommand>> = 0;
+
+		/// @brief Called once a requested read has been performed
+		/// @param timeStamp The update time stamp
+		/// @param payloadOrError This is a variant-like type that will hold either the payload of the transaction, or an std::error_code object
+		/// containing a read error. The payload refers to a buffer belonging to the coalescer, and is only valid for the duration of the call.
+		virtual auto coalescedReadCompleted(std::chrono::system_clock::time_point timeStamp,
+			const utils::eh::expected<std::reference_wrapper<const ReadCommand::Payload>, std::error_code> &payloadOrError) -> void = 0;
+
+	private:
+		/// @brief Whether the client has requested a read since the last call to ReadCoalescer::read()
+		std::atomic<bool> _readRequested { false };
+
+		friend class ReadCoalescer;
+	};
+
+	/// @brief Adds a client, and sizes the buffers so that reading never needs to allocate memory
+	/// @note This function must not be called once reading has begun. The payload size and the read commands of the client
+	/// must already be known.
+	auto addClient(std::reference_wrapper<Client> client) -> void;
+
+	/// @brief Requests that the data of a client be read the next time read() is called
+	/// @note This function may be called from any thread.
+	static auto requestRead(Client &client) noexcept -> void
+	{
+		client._readRequested.store(true, std::memory_order_release);
+	}
+
+	/// @brief Reads the data of all clients that requested a read, and hands the results to the clients
+	/// @param handle The handle to send the read commands on
+	/// @param timeStamp The update time stamp
+	/// @param maxPduSize The maximum number of payload bytes a single read command may request, or 0 if there is no limit.
+	auto read(const IoComponentHandle &handle, std::chrono::system_clock::time_point timeStamp, std::size_t maxPduSize) -> void;
+
+	/// @brief Discards all outstanding requests, e.g. because the I/O component is not connected
+	auto discardRequests() noexcept -> void;
+
+private:
+	/// @brief A contiguous range of device addresses
+	struct AddressRange final
+	{
+		/// @brief The first address
+		std::size_t _address;
+		/// @brief The number of bytes
+		std::size_t _size;
+	};
+
+	/// @brief Collects the clients that requested a read into _requestedClients
+	auto collectRequests() noexcept -> void;
+
+	/// @brief Merges the address ranges of all requested clients into _mergedRanges
+	auto mergeRanges(std::size_t maxPduSize) -> void;
+
+	/// @brief All the clients
+	std::vector<std::reference_wrapper<Client>> _clients;
+
+	/// @brief The clients that requested a read in the current cycle. This is preallocated to avoid allocations while reading.
+	std::vector<std::reference_wrapper<Client>> _requestedClients;
+
+	/// @brief The merged address ranges to read in the current cycle.
+	///
+	/// This is preallocated in addClient() for the read commands of all the clients, to avoid allocations while reading.
+	std::vector<AddressRange> _mergedRanges;
+
+	/// @brief A receive buffer covering the payloads of a group of clients whose address ranges overlap or touch
+	struct BufferGroup final
+	{
+		/// @brief The device address of the first byte of the buffer
+		std::size_t _origin;
+		/// @brief The buffer the responses are received into
+		std::vector<std::byte> _receiveBuffer;
+	};
+
+	/// @brief Splits the payloads of all the clients into buffer groups
+	auto regroup() -> void;
+
+	/// @brief Gets the buffer group that contains a device address
+	auto bufferGroup(std::size_t address) noexcept -> BufferGroup &;
+
+	/// @brief The receive buffers, sorted by origin.
+	///
+	/// Each group covers only clients whose payloads overlap or touch, so that clients far apart in the address space do
+	/// not need a buffer spanning the gap between them. Merged read commands never span more than one group, because ranges are
+	/// only merged if they overlap or touch. The groups are allocated in addClient(), so that any combination of clients can
+	/// be read without allocations.
+	std::vector<BufferGroup> _bufferGroups;
+};
+
+inline ReadCoalescer::Client::~Client() = default;
+
+} // namespace xentara::plugins::templateDriver
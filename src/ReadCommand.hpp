@@ -1,8 +1,16 @@
 // Copyright (c) embedded ocean GmbH
 #pragma once
 
+#include "CustomError.hpp"
+
 #include <xentara/utils/tools/Unique.hpp>
 
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <system_error>
+#include <type_traits>
+
 namespace xentara::plugins::templateDriver
 {
 
@@ -11,11 +19,96 @@ namespace xentara::plugins::templateDriver
 class ReadCommand final : private utils::tools::Unique
 {
 public:
-	/// @brief Some class that represents the data received from the device
-	/// @todo use a suitable class to represent the data
+	/// @brief The data received from the device.
+	///
+	/// The payload does not hold the data itself, but refers to the buffer the response was received into.
+	/// Inputs decode their values directly from that buffer.
 	class Payload final
 	{
+	public:
+		/// @brief Constructs a payload that refers to received data
+		/// @param data The received data. The data is not copied, so it must remain valid as long as the payload is used.
+		constexpr Payload(std::span<const std::byte> data) noexcept : _data(data)
+		{
+		}
+
+		/// @brief Gets the received data
+		constexpr auto data() const noexcept -> std::span<const std::byte>
+		{
+			return _data;
+		}
+
+		/// @brief Decodes a value from the payload
+		/// @param offset The offset of the value within the payload, in bytes
+		/// @return The decoded value
+		/// @note The caller must make sure that the payload is large enough to contain the value.
+		template <typename Value>
+			requires std::is_trivially_copyable_v<Value>
+		auto decode(std::size_t offset) const noexcept -> Value
+		{
+			// Use std::memcpy(), because the value may not be properly aligned within the payload
+			Value value;
+			std::memcpy(&value, _data.data() + offset, sizeof(Value));
+
+			/// @todo convert the value from the byte order used by the I/O component, if necessary
+
+			return value;
+		}
+
+	private:
+		/// @brief The received data
+		std::span<const std::byte> _data;
 	};
+
+	/// @brief Constructs a command that reads part of the payload
+	///
+	/// An I/O transaction may use several read commands if its payload is too large for a single protocol data unit.
+	/// Each command reads a range of the payload, and the responses of all the commands are received into the same buffer,
+	/// at the offsets of their respective ranges.
+	/// @param offset The offset of the range within the payload, in bytes
+	/// @param size The number of bytes to read
+	/// @todo add any information needed to construct the actual request, like e.g. the start address
+	ReadCommand(std::size_t offset, std::size_t size) noexcept : _offset(offset), _size(size)
+	{
+	}
+
+	/// @brief Gets the offset of the range read by this command within the payload, in bytes
+	auto offset() const noexcept -> std::size_t
+	{
+		return _offset;
+	}
+
+	/// @brief Gets the number of bytes the response must contain
+	auto size() const noexcept -> std::size_t
+	{
+		return _size;
+	}
+
+	/// @brief Gets the part of a receive buffer the response to this command must be received into
+	/// @param receiveBuffer A buffer large enough to hold the entire payload
+	auto responseBuffer(std::span<std::byte> receiveBuffer) const noexcept -> std::span<std::byte>
+	{
+		return receiveBuffer.subspan(_offset, _size);
+	}
+
+	/// @brief Checks whether a response has the correct size
+	/// @param responseSize The number of bytes received
+	/// @return CustomError::ResponseTooShort if the response is too short, or a default constructed std::error_code otherwise.
+	auto validateResponse(std::size_t responseSize) const noexcept -> std::error_code
+	{
+		if (responseSize < _size)
+		{
+			return CustomError::ResponseTooShort;
+		}
+
+		return {};
+	}
+
+private:
+	/// @brief The offset of the range within the payload, in bytes
+	std::size_t _offset;
+	/// @brief The number of bytes to read
+	std::size_t _size;
 };
 
-} // namespace xentara::plugins::templateDriver
\ No newline at end of file
+} // namespace xentara::plugins::templateDriver
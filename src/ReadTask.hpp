@@ -50,14 +50,10 @@ private:
 template <typename Target>
 auto ReadTask<Target>::preparePreOperational(const process::ExecutionContext &context) -> Status
 {
-	// Request a connection
+	// Request a connection. The connection is established in the background, so there is nothing to read yet. The value
+	// is read for the first time when the task is executed in the pre-operational stage after the connection is up.
 	_target.get().requestConnect(context.scheduledTime());
 
-	// Read the value once to initialize it
-	operational(context);
-
-	// We are done now. Even if we couldn't read the value, we proceed to the next stage,
-	// because attempting again is unlikely to succeed any better.
 	return Status::Ready;
 }
 
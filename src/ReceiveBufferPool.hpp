@@ -0,0 +1,68 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include <xentara/utils/tools/Unique.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <span>
+
+namespace xentara::plugins::templateDriver
+{
+
+/// @brief A pool of preallocated buffers that responses from the I/O component are received into.
+///
+/// All buffers are allocated as a single block when the pool is reset, so that receiving data does not require
+/// any memory allocations. The buffers are handed out in round-robin order, so a buffer returned by acquire()
+/// remains untouched until acquire() has been called bufferCount() more times.
+///
+/// @note This class is not thread-safe. Buffers must only be acquired by the thread that sends the read commands.
+class ReceiveBufferPool final : private utils::tools::Unique
+{
+public:
+	/// @brief Allocates the buffers.
+	///
+	/// The buffers are zero-initialized. If the read commands do not cover the entire buffer, the bytes between them are never
+	/// received, and must have a defined value so that whole payloads can be compared.
+	/// @param bufferCount The number of buffers. Must be at least 1.
+	/// @param bufferSize The size of each buffer in bytes.
+	auto reset(std::size_t bufferCount, std::size_t bufferSize) -> void
+	{
+		_storage = std::make_unique<std::byte[]>(bufferCount * bufferSize);
+		_bufferCount = bufferCount;
+		_bufferSize = bufferSize;
+		_nextBuffer = 0;
+	}
+
+	/// @brief Gets the next free buffer
+	auto acquire() noexcept -> std::span<std::byte>
+	{
+		const std::span<std::byte> buffer { _storage.get() + _nextBuffer * _bufferSize, _bufferSize };
+		_nextBuffer = (_nextBuffer + 1) % _bufferCount;
+		return buffer;
+	}
+
+	/// @brief Gets the number of buffers
+	auto bufferCount() const noexcept -> std::size_t
+	{
+		return _bufferCount;
+	}
+
+	/// @brief Gets the size of each buffer in bytes
+	auto bufferSize() const noexcept -> std::size_t
+	{
+		return _bufferSize;
+	}
+
+private:
+	/// @brief The storage for all the buffers
+	std::unique_ptr<std::byte[]> _storage;
+	/// @brief The number of buffers
+	std::size_t _bufferCount { 0 };
+	/// @brief The size of each buffer in bytes
+	std::size_t _bufferSize { 0 };
+	/// @brief The index of the buffer that will be returned by the next call to acquire()
+	std::size_t _nextBuffer { 0 };
+};
+
+} // namespace xentara::plugins::templateDriver
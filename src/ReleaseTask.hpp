@@ -0,0 +1,93 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include <xentara/process/Task.hpp>
+#include <xentara/process/ExecutionContext.hpp>
+
+#include <chrono>
+#include <functional>
+
+namespace xentara::plugins::templateDriver
+{
+
+/// @brief This class providing callbacks for the Xentara scheduler for the "release" task of I/O transactions
+template <typename Target>
+class ReleaseTask final : public process::Task
+{
+public:
+	/// @brief This constuctor attached the task to its target
+	ReleaseTask(std::reference_wrapper<Target> target) : _target(target)
+	{
+	}
+
+	/// @name Virtual Overrides for process::Task
+	/// @{
+
+	auto stages() const -> Stages final
+	{
+		return Stage::PreOperational | Stage::Operational | Stage::PostOperational;
+	}
+
+	auto preparePreOperational(const process::ExecutionContext &context) -> Status final;
+
+	auto preOperational(const process::ExecutionContext &context) -> Status final;
+
+	auto operational(const process::ExecutionContext &context) -> void final;
+
+	auto preparePostOperational(const process::ExecutionContext &context) -> Status final;
+
+	auto postOperational(const process::ExecutionContext &context) -> Status final;
+
+	auto finishPostOperational(const process::ExecutionContext &context) -> void final;
+		
+	/// @}
+
+private:
+	/// @brief A reference to the target element
+	std::reference_wrapper<Target> _target;
+};
+
+template <typename Target>
+auto ReleaseTask<Target>::preparePreOperational(const process::ExecutionContext &context) -> Status
+{
+	// Releasing values does not communicate with the I/O component, so we don't need a connection
+	return Status::Ready;
+}
+
+template <typename Target>
+auto ReleaseTask<Target>::preOperational(const process::ExecutionContext &context) -> Status
+{
+	// We just do the same thing as in the operational stage
+	operational(context);
+
+	return Status::Ready;
+}
+
+template <typename Target>
+auto ReleaseTask<Target>::operational(const process::ExecutionContext &context) -> void
+{
+	_target.get().performReleaseTask(context);
+}
+
+template <typename Target>
+auto ReleaseTask<Target>::preparePostOperational(const process::ExecutionContext &context) -> Status
+{
+	// Everything in the post operational stage is optional, so we can report ready right away
+	return Status::Ready;
+}
+
+template <typename Target>
+auto ReleaseTask<Target>::postOperational(const process::ExecutionContext &context) -> Status
+{
+	// We just do the same thing as in the operational stage
+	operational(context);
+
+	return Status::Ready;
+}
+
+template <typename Target>
+auto ReleaseTask<Target>::finishPostOperational(const process::ExecutionContext &context) -> void
+{
+}
+
+} // namespace xentara::plugins::templateDriver
\ No newline at end of file
@@ -0,0 +1,154 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <type_traits>
+
+namespace xentara::plugins::templateDriver
+{
+
+/// @brief A thread-safe, lock-free queue with a fixed capacity that can be used by multiple producers and consumers.
+///
+/// The queue is a ring of cells, each of which holds a sequence number that tells producers and consumers whether the
+/// cell is ready to be written or read. The storage for the cells is allocated once by the constructor, so that enqueuing
+/// and dequeuing values never allocates memory.
+template <typename DataType>
+class RingQueue final
+{
+public:
+	/// @brief Constructor
+	/// @param capacity The number of values the queue can hold. The ring is rounded up to the next power of two, but the queue never
+	/// holds more than this many values.
+	explicit RingQueue(std::size_t capacity) :
+		_capacity(std::max<std::size_t>(capacity, 1)),
+		_ringSize(std::bit_ceil(_capacity)),
+		_cells(std::make_unique<Cell[]>(_ringSize))
+	{
+		// Each cell is initially ready to be written for the first pass around the ring
+		for (std::size_t index = 0; index < _ringSize; ++index)
+		{
+			_cells[index]._sequence.store(index, std::memory_order_relaxed);
+		}
+	}
+
+	/// @brief Gets the number of values the queue can hold
+	constexpr auto capacity() const noexcept -> std::size_t
+	{
+		return _capacity;
+	}
+
+	/// @brief Enqueues a value.
+	/// @param value The value to place in the queue
+	/// @return Returns *false* if the queue was full, and the value was not enqueued.
+	auto enqueue(const DataType &value) noexcept -> bool
+	{
+		auto position = _enqueuePosition.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			// Enforce the capacity, which may be smaller than the ring. The dequeue position may be out of date, but it can only
+			// lag behind, which makes the queue look fuller than it is, never emptier. Our own position may be out of date, too,
+			// which makes the difference negative. The cell check below handles that case.
+			const auto count = static_cast<std::ptrdiff_t>(position - _dequeuePosition.load(std::memory_order_acquire));
+			if (count >= static_cast<std::ptrdiff_t>(_capacity))
+			{
+				return false;
+			}
+
+			auto &cell = _cells[position & (_ringSize - 1)];
+			const auto sequence = cell._sequence.load(std::memory_order_acquire);
+			const auto difference = static_cast<std::ptrdiff_t>(sequence - position);
+
+			// If the cell is ready to be written, try to claim it
+			if (difference == 0)
+			{
+				if (_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				{
+					cell._value = value;
+					// Mark the cell as ready to be read
+					cell._sequence.store(position + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			// If the cell still contains a value from the last pass around the ring, the queue is full
+			else if (difference < 0)
+			{
+				return false;
+			}
+			// Another producer has claimed the cell, so try again with the current position
+			else
+			{
+				position = _enqueuePosition.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	/// @brief Gets the oldest value and removes it from the queue
+	/// @return The oldest value or std::nullopt if the queue is empty
+	auto dequeue() noexcept -> std::optional<DataType>
+	{
+		auto position = _dequeuePosition.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			auto &cell = _cells[position & (_ringSize - 1)];
+			const auto sequence = cell._sequence.load(std::memory_order_acquire);
+			const auto difference = static_cast<std::ptrdiff_t>(sequence - (position + 1));
+
+			// If the cell is ready to be read, try to claim it
+			if (difference == 0)
+			{
+				if (_dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				{
+					const auto value = cell._value;
+					// Mark the cell as ready to be written for the next pass around the ring
+					cell._sequence.store(position + _ringSize, std::memory_order_release);
+					return value;
+				}
+			}
+			// If no value has been written to the cell yet, the queue is empty
+			else if (difference < 0)
+			{
+				return std::nullopt;
+			}
+			// Another consumer has claimed the cell, so try again with the current position
+			else
+			{
+				position = _dequeuePosition.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+private:
+	/// @brief The size of a cache line, used to keep the producer and consumer positions apart
+	static constexpr std::size_t kCacheLineSize = 64;
+
+	/// @brief A cell in the ring
+	struct Cell final
+	{
+		/// @brief The sequence number of the cell
+		std::atomic<std::size_t> _sequence;
+		/// @brief The value
+		DataType _value {};
+	};
+
+	// The value is copied without synchronisation other than the sequence number
+	static_assert(std::is_trivially_copyable_v<DataType>);
+
+	/// @brief The maximum number of values in the queue
+	std::size_t _capacity;
+	/// @brief The number of cells. This is always a power of two, and at least _capacity.
+	std::size_t _ringSize;
+	/// @brief The cells
+	std::unique_ptr<Cell[]> _cells;
+
+	/// @brief The position the next value will be enqueued at
+	alignas(kCacheLineSize) std::atomic<std::size_t> _enqueuePosition { 0 };
+	/// @brief The position the next value will be dequeued from
+	alignas(kCacheLineSize) std::atomic<std::size_t> _dequeuePosition { 0 };
+};
+
+} // namespace xentara::plugins::templateDriver
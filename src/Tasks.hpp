@@ -7,9 +7,11 @@
 namespace xentara::plugins::templateDriver::tasks
 {
 
-/// @brief A Xentara task used to read the data points attached to an I/O transaction
+/// @brief A Xentara task used to read the data points attached to an I/O transaction, or to perform the coalesced reads of an I/O component
 extern const process::Task::Role kRead;
 /// @brief A Xentara task used to write the data points attached to an I/O transaction
 extern const process::Task::Role kWrite;
+/// @brief A Xentara task used to release the staged values of the write group of an I/O transaction
+extern const process::Task::Role kRelease;
 
 } // namespace xentara::plugins::templateDriver::tasks
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "TemplateInput.hpp"
 
 #include "Attributes.hpp"
+#include "DecodePlan.hpp"
 #include "TemplateIoTransaction.hpp"
 
 #include <xentara/config/Context.hpp>
@@ -15,17 +16,26 @@
 #include <xentara/utils/json/decoder/Object.hpp>
 #include <xentara/utils/json/decoder/Errors.hpp>
 
+#include <cmath>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <variant>
+
 namespace xentara::plugins::templateDriver
 {
 	
 using namespace std::literals;
 
-const model::Attribute TemplateInput::kValueAttribute { model::Attribute::kValue, model::Attribute::Access::ReadOnly, data::DataType::kFloatingPoint };
+const model::Attribute TemplateInput::kBooleanValueAttribute { model::Attribute::kValue, model::Attribute::Access::ReadOnly, data::DataType::kBoolean };
+const model::Attribute TemplateInput::kIntegerValueAttribute { model::Attribute::kValue, model::Attribute::Access::ReadOnly, data::DataType::kInteger };
+const model::Attribute TemplateInput::kFloatingPointValueAttribute { model::Attribute::kValue, model::Attribute::Access::ReadOnly, data::DataType::kFloatingPoint };
 
 auto TemplateInput::load(utils::json::decoder::Object &jsonObject, config::Context &context) -> void
 {
 	// Go through all the members of the JSON object that represents this object
 	bool ioTransactionLoaded = false;
+	std::optional<WireType> wireType;
 	for (auto && [name, value] : jsonObject)
     {
 		/// @todo use a more descriptive keyword, e.g. "poll"
@@ -38,6 +48,45 @@ auto TemplateInput::load(utils::json::decoder::Object &jsonObject, config::Conte
 				});
 			ioTransactionLoaded = true;
 		}
+		else if (name == "dataType"sv)
+		{
+			const auto valueType = parseValueType(value.asString<std::string>());
+			if (!valueType)
+			{
+				utils::json::decoder::throwWithLocation(value, std::runtime_error("unknown data type in template input"));
+			}
+			_valueType = *valueType;
+		}
+		else if (name == "offset"sv)
+		{
+			_dataOffset = value.asNumber<std::size_t>();
+		}
+		else if (name == "wireType"sv)
+		{
+			wireType = parseWireType(value.asString<std::string>());
+			if (!wireType)
+			{
+				utils::json::decoder::throwWithLocation(value, std::runtime_error("unknown wire type in template input"));
+			}
+		}
+		else if (name == "deadband"sv)
+		{
+			const auto deadband = value.asNumber<double>();
+			if (!std::isfinite(deadband) || deadband < 0)
+			{
+				utils::json::decoder::throwWithLocation(value, std::runtime_error("invalid deadband in template input"));
+			}
+			_deadband._absolute = deadband;
+		}
+		else if (name == "percentDeadband"sv)
+		{
+			const auto percentDeadband = value.asNumber<double>();
+			if (!std::isfinite(percentDeadband) || percentDeadband < 0)
+			{
+				utils::json::decoder::throwWithLocation(value, std::runtime_error("invalid percent deadband in template input"));
+			}
+			_deadband._relative = percentDeadband / 100.0;
+		}
 		/// @todo load custom configuration parameters
 		else if (name == "TODO"sv)
 		{
@@ -65,6 +114,16 @@ auto TemplateInput::load(utils::json::decoder::Object &jsonObject, config::Conte
 		/// @todo replace "I/O transaction" and "template input" with more descriptive names
 		utils::json::decoder::throwWithLocation(jsonObject, std::runtime_error("missing I/O transaction in template input"));
 	}
+	// Deadbands only make sense for numbers
+	if (_deadband && !supportsDeadband(_valueType))
+	{
+		utils::json::decoder::throwWithLocation(jsonObject, std::runtime_error("deadband specified for boolean template input"));
+	}
+
+	// Use the native encoding of the value type if no wire type was specified
+	_wireType = wireType.value_or(nativeWireType(_valueType));
+	// Create the state for the correct type
+	visitValueType(_valueType, [this]<typename DataType>(std::type_identity<DataType>) { _state.emplace<PerValueReadState<DataType>>(); });
 	/// @todo perform consistency and completeness checks
 	if (!"TODO")
 	{
@@ -73,9 +132,23 @@ auto TemplateInput::load(utils::json::decoder::Object &jsonObject, config::Conte
 	}
 }
 
+auto TemplateInput::valueAttribute() const noexcept -> const model::Attribute &
+{
+	switch (_valueType)
+	{
+	case ValueType::Boolean:
+		return kBooleanValueAttribute;
+	case ValueType::Float:
+	case ValueType::Double:
+		return kFloatingPointValueAttribute;
+	default:
+		return kIntegerValueAttribute;
+	}
+}
+
 auto TemplateInput::dataType() const -> const data::DataType &
 {
-	return kValueAttribute.dataType();
+	return valueAttribute().dataType();
 }
 
 auto TemplateInput::directions() const -> io::Directions
@@ -94,10 +167,10 @@ auto TemplateInput::forEachAttribute(const model::ForEachAttributeFunction &func
 
 	return
 		// Handle all the attributes we support directly
-		function(kValueAttribute) ||
+		function(valueAttribute()) ||
 
 		// Handle the state attributes
-		_state.forEachAttribute(function) ||
+		std::visit([&](const auto &state) { return state.forEachAttribute(function); }, _state) ||
 		// Also handle the common read state attributes from the I/O transaction
 		_ioTransaction->forEachReadStateAttribute(function);
 
@@ -115,7 +188,7 @@ auto TemplateInput::forEachEvent(const model::ForEachEventFunction &function) ->
 
 	return
 		// Handle the state events
-		_state.forEachEvent(function, sharedFromThis()) ||
+		std::visit([&](auto &state) { return state.forEachEvent(function, sharedFromThis()); }, _state) ||
 		// Also handle the common read state events from the I/O transaction
 		_ioTransaction->forEachReadStateEvent(function);
 
@@ -135,13 +208,13 @@ auto TemplateInput::makeReadHandle(const model::Attribute &attribute) const noex
 	const auto &dataBlock = _ioTransaction->readDataBlock();
 	
 	// Handle the value attribute separately
-	if (attribute == kValueAttribute)
+	if (attribute == valueAttribute())
 	{
-		return _state.valueReadHandle(dataBlock);
+		return std::visit([&](const auto &state) { return state.valueReadHandle(dataBlock); }, _state);
 	}
 	
 	// Handle the state attributes
-	if (auto handle = _state.makeReadHandle(dataBlock, attribute))
+	if (auto handle = std::visit([&](const auto &state) { return state.makeReadHandle(dataBlock, attribute); }, _state))
 	{
 		return handle;
 	}
@@ -156,32 +229,9 @@ auto TemplateInput::makeReadHandle(const model::Attribute &attribute) const noex
 	return std::nullopt;
 }
 
-auto TemplateInput::attachInput(memory::Array &dataArray, std::size_t &eventCount) -> void
+auto TemplateInput::addToDecodePlan(DecodePlan &decodePlan) -> void
 {
-	_state.attach(dataArray, eventCount);
-}
-
-auto TemplateInput::updateReadState(WriteSentinel &writeSentinel,
-	std::chrono::system_clock::time_point timeStamp,
-	const utils::eh::expected<std::reference_wrapper<const ReadCommand::Payload>, std::error_code> &payloadOrError,
-	const CommonReadState::Changes &commonChanges,
-	PendingEventList &eventsToRaise) -> void
-{
-	// Check if we have a valid payload
-	if (payloadOrError)
-	{
-		/// @todo decode the value from the payload data
-		double value = {};
-
-		// Update the state
-		_state.update(writeSentinel, timeStamp, value, commonChanges, eventsToRaise);
-	}
-	// We have an error
-	else
-	{
-		// Update the state with the error
-		_state.update(writeSentinel, timeStamp, utils::eh::unexpected(payloadOrError.error()), commonChanges, eventsToRaise);
-	}
+	std::visit([&](auto &state) { decodePlan.add(_dataOffset, _wireType, state, _deadband); }, _state);
 }
 
 } // namespace xentara::plugins::templateDriver
\ No newline at end of file
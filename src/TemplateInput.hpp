@@ -2,7 +2,10 @@
 #pragma once
 
 #include "AbstractInput.hpp"
+#include "Deadband.hpp"
 #include "PerValueReadState.hpp"
+#include "ValueType.hpp"
+#include "WireType.hpp"
 
 #include <xentara/skill/DataPoint.hpp>
 #include <xentara/skill/EnableSharedFromThis.hpp>
@@ -58,20 +61,18 @@ public:
 		return _ioComponent;
 	}
 	
-	auto attachInput(memory::Array &dataArray, std::size_t &eventCount) -> void final;
-
-	auto updateReadState(WriteSentinel &writeSentinel,
-		std::chrono::system_clock::time_point timeStamp,
-		const utils::eh::expected<std::reference_wrapper<const ReadCommand::Payload>, std::error_code> &payloadOrError,
-		const CommonReadState::Changes &commonChanges,
-		PendingEventList &eventsToRaise) -> void final;
+	auto addToDecodePlan(DecodePlan &decodePlan) -> void final;
 		
 	/// @}
 
-	/// @brief A Xentara attribute containing the current value.
+	/// @brief A Xentara attribute containing the current value, for boolean inputs.
 	/// @note This is a member of this class rather than of the attributes namespace, because the access flags
 	/// and type may differ from class to class
-	static const model::Attribute kValueAttribute;
+	static const model::Attribute kBooleanValueAttribute;
+	/// @brief A Xentara attribute containing the current value, for integer inputs.
+	static const model::Attribute kIntegerValueAttribute;
+	/// @brief A Xentara attribute containing the current value, for floating point inputs.
+	static const model::Attribute kFloatingPointValueAttribute;
 
 private:
 	/// @name Virtual Overrides for skill::DataPoint
@@ -81,6 +82,9 @@ private:
 
 	/// @}
 
+	/// @brief Gets the value attribute matching the value type
+	auto valueAttribute() const noexcept -> const model::Attribute &;
+
 	/// @brief The I/O component this input belongs to
 	/// @todo give this a more descriptive name, e.g. "_device"
 	std::reference_wrapper<TemplateIoComponent> _ioComponent;
@@ -89,12 +93,21 @@ private:
 	/// @todo give this a more descriptive name, e.g. "_poll"
 	TemplateIoTransaction *_ioTransaction { nullptr };
 
+	/// @brief The type of the value
+	ValueType _valueType { ValueType::Double };
+
+	/// @brief The offset of the value within the payload of a read command, in bytes
+	std::size_t _dataOffset { 0 };
+	/// @brief The encoding of the value within the payload of a read command. This defaults to the native encoding of the value type.
+	WireType _wireType { WireType::Float64 };
+	/// @brief The deadband used to suppress insignificant changes of the value
+	Deadband _deadband;
+
 	/// @class xentara::plugins::templateDriver::TemplateInput
-	/// @todo add information needed to decode the value from the payload of a read command, like e.g. a data offset.
+	/// @todo add any other information needed to decode the value from the payload of a read command.
 
-	/// @brief The state
-	/// @todo use the correct value type
-	PerValueReadState<double> _state;
+	/// @brief The state, instantiated for the value type
+	ValueTypeVariant<PerValueReadState> _state;
 };
 
 } // namespace xentara::plugins::templateDriver
\ No newline at end of file
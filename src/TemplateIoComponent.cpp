@@ -2,6 +2,8 @@
 #include "TemplateIoComponent.hpp"
 
 #include "Attributes.hpp"
+#include "Backoff.hpp"
+#include "Tasks.hpp"
 #include "TemplateIoTransaction.hpp"
 #include "TemplateInput.hpp"
 #include "TemplateOutput.hpp"
@@ -21,7 +23,11 @@
 #include <xentara/utils/json/decoder/Object.hpp>
 #include <xentara/utils/json/decoder/Errors.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <string>
 #include <string_view>
+#include <system_error>
 
 #ifdef _WIN32
 #	include <Windows.h>
@@ -39,8 +45,88 @@ auto TemplateIoComponent::load(utils::json::decoder::Object &jsonObject, config:
 	// Go through all the members of the JSON object that represents this object
 	for (auto && [name, value] : jsonObject)
     {
+		if (name == "maxPduSize"sv)
+		{
+			_maxPduSize = value.asNumber<std::size_t>();
+		}
+		else if (name == "connectionCount"sv)
+		{
+			_connectionCount = value.asNumber<std::size_t>();
+			if (_connectionCount == 0)
+			{
+				utils::json::decoder::throwWithLocation(value, std::runtime_error("invalid connection count in template I/O component"));
+			}
+		}
+		else if (name == "connectionAssignment"sv)
+		{
+			const auto assignment = value.asString<std::string>();
+			if (assignment == "sticky"sv)
+			{
+				_connectionAssignment = ConnectionAssignment::Sticky;
+			}
+			else if (assignment == "leastLoaded"sv)
+			{
+				_connectionAssignment = ConnectionAssignment::LeastLoaded;
+			}
+			else
+			{
+				utils::json::decoder::throwWithLocation(value, std::runtime_error("unknown connection assignment in template I/O component"));
+			}
+		}
+		else if (name == "connectTimeout"sv)
+		{
+			_connectTimeout = std::chrono::milliseconds(value.asNumber<std::uint64_t>());
+			if (_connectTimeout == std::chrono::system_clock::duration::zero())
+			{
+				utils::json::decoder::throwWithLocation(value, std::runtime_error("invalid connect timeout in template I/O component"));
+			}
+		}
+		else if (name == "reconnectDelay"sv)
+		{
+			_reconnectDelay = std::chrono::milliseconds(value.asNumber<std::uint64_t>());
+		}
+		else if (name == "maxReconnectDelay"sv)
+		{
+			_maxReconnectDelay = std::chrono::milliseconds(value.asNumber<std::uint64_t>());
+		}
+		else if (name == "reconnectJitter"sv)
+		{
+			_reconnectJitter = value.asNumber<double>();
+			if (!(_reconnectJitter >= 0 && _reconnectJitter <= 1))
+			{
+				utils::json::decoder::throwWithLocation(value, std::runtime_error("invalid reconnect jitter in template I/O component"));
+			}
+		}
+		else if (name == "keepaliveInterval"sv)
+		{
+			_keepaliveInterval = std::chrono::milliseconds(value.asNumber<std::uint64_t>());
+		}
+		else if (name == "keepaliveMissCount"sv)
+		{
+			_keepaliveMissCount = value.asNumber<std::size_t>();
+			if (_keepaliveMissCount == 0)
+			{
+				utils::json::decoder::throwWithLocation(value, std::runtime_error("invalid keepalive miss count in template I/O component"));
+			}
+		}
+		else if (name == "maxWriteRate"sv)
+		{
+			_maxWriteRate = value.asNumber<double>();
+			if (!std::isfinite(_maxWriteRate) || _maxWriteRate < 0)
+			{
+				utils::json::decoder::throwWithLocation(value, std::runtime_error("invalid maximum write rate in template I/O component"));
+			}
+		}
+		else if (name == "writeBurst"sv)
+		{
+			_writeBurst = value.asNumber<std::size_t>();
+			if (_writeBurst == 0)
+			{
+				utils::json::decoder::throwWithLocation(value, std::runtime_error("invalid write burst in template I/O component"));
+			}
+		}
 		/// @todo load configuration parameters
-		if (name == "TODO"sv)
+		else if (name == "TODO"sv)
 		{
 			/// @todo parse the value correctly
 			auto todo = value.asNumber<std::uint64_t>();
@@ -60,6 +146,12 @@ auto TemplateIoComponent::load(utils::json::decoder::Object &jsonObject, config:
 		}
     }
 
+	// Create the connection pool
+	_connections = std::make_unique<Connection[]>(_connectionCount);
+
+	// Set up the write rate limit
+	_writeRateLimiter.configure(_maxWriteRate, _writeBurst);
+
 	/// @todo perform consistency and completeness checks
 	if (!"TODO")
 	{
@@ -68,6 +160,23 @@ auto TemplateIoComponent::load(utils::json::decoder::Object &jsonObject, config:
 	}
 }
 
+auto TemplateIoComponent::performReadTask(const process::ExecutionContext &context) -> void
+{
+	// Only perform the read only if we are connected
+	if (!connected())
+	{
+		// The transactions have been invalidated anyway, so there is no need to keep their requests around
+		_readCoalescer.discardRequests();
+		return;
+	}
+
+	// Borrow a connection for the reads
+	const auto handle = leaseHandle(0);
+
+	// Read the data of all the transactions that requested it
+	_readCoalescer.read(*handle, context.scheduledTime(), _maxPduSize);
+}
+
 auto TemplateIoComponent::performReconnectTask(const process::ExecutionContext &context) -> void
 {
 	// Only perform the reconnect if we are supposed to be connected in the first place
@@ -75,8 +184,14 @@ auto TemplateIoComponent::performReconnectTask(const process::ExecutionContext &
 	{
 		return;
 	}
-	// Also don't reconnect if we are already connected
-	if (_handle)
+	// Also don't reconnect if we are already connected, but make sure the connection is still alive
+	if (connected())
+	{
+		checkKeepalive(context.scheduledTime());
+		return;
+	}
+	// Back off after failed attempts
+	if (context.scheduledTime() < _nextConnectionAttempt.load(std::memory_order_relaxed))
 	{
 		return;
 	}
@@ -85,25 +200,81 @@ auto TemplateIoComponent::performReconnectTask(const process::ExecutionContext &
 	// if it requires non-existent hardware, like a missing network adapter or I/O card, for example.
 	// see isConnectionError() for an example on how to check error codes.
 
-	// Attempt a connection
-	connect(context.scheduledTime());
+	// Have the connect thread attempt a connection, so we don't block the task
+	requestConnectAttempt();
+}
+
+auto TemplateIoComponent::connectThread(std::stop_token stopToken) -> void
+{
+	// Wake up the thread when it is asked to stop
+	std::stop_callback wakeUp { stopToken, [this]() {
+		_connectAttemptRequested.store(true, std::memory_order_release);
+		_connectAttemptRequested.notify_one();
+	} };
+
+	while (!stopToken.stop_requested())
+	{
+		// Wait until a connection attempt is requested
+		_connectAttemptRequested.wait(false, std::memory_order_acquire);
+		// Reset the flag before connecting, so that requests made during the attempt are not lost
+		_connectAttemptRequested.exchange(false, std::memory_order_acq_rel);
+		if (stopToken.stop_requested())
+		{
+			break;
+		}
+
+		// Attempt the connection. We have no scheduled time, so we use the current time.
+		connect(std::chrono::system_clock::now());
+	}
 }
 
 auto TemplateIoComponent::connect(std::chrono::system_clock::time_point timeStamp) -> void
 {
+	std::lock_guard lock { _connectionMutex };
+
+	// The connection may have been established or no longer be wanted by the time we get here
+	if (_connectionRequestCount.load(std::memory_order_relaxed) == 0 || connected())
+	{
+		return;
+	}
+
 	try
 	{
-		/// @todo try to establish the connection, and set the _handle object
+		// The whole pool must be connected within the connect timeout
+		const auto deadline = std::chrono::steady_clock::now() + _connectTimeout;
 
-		/// @todo if the connect function does not throw errors, but uses return types or internal handle state,
-		// throw an std::system_error here on failure, or call updateState() directly.
-		
-		// Note: If your connect function uses normal system error codes (errno on Linux or GetLastError() on Windows), you
-		// should create std::error_codes using std::system_category(). If you are using a library and/or protocol that provides
-		// its own error codes, you should define a custom error category.
+		// Open all the connections in the pool
+		for (std::size_t index = 0; index < _connectionCount; ++index)
+		{
+			/// @todo try to establish the connection, and store a new handle created using std::make_shared() in
+			// _connections[index]._handle. Use a non-blocking connect that waits no longer than deadline, throwing an
+			// std::system_error with std::errc::timed_out if it expires, so that the connect thread is not blocked for the
+			// operating system's much longer default timeout.
+
+			/// @todo if the connect function does not throw errors, but uses return types or internal handle state,
+			// throw an std::system_error here on failure, or call updateState() directly.
+			
+			// Note: If your connect function uses normal system error codes (errno on Linux or GetLastError() on Windows), you
+			// should create std::error_codes using std::system_category(). If you are using a library and/or protocol that provides
+			// its own error codes, you should define a custom error category.
+
+			// Give up if the connections opened so far have already used up the timeout
+			if (std::chrono::steady_clock::now() >= deadline)
+			{
+				throw std::system_error(std::make_error_code(std::errc::timed_out));
+			}
+		}
 
-		// The connection was successful
+		// The connection was successful. The error sinks are notified before the connection is marked as open, so that
+		// the I/O transactions don't start reading while they are still updating their state.
 		updateState(timeStamp, std::error_code());
+		// Start probing the new connections after a full interval
+		_missedKeepalives.store(0, std::memory_order_relaxed);
+		_nextKeepaliveTime.store(timeStamp + _keepaliveInterval, std::memory_order_relaxed);
+		_connected.store(true, std::memory_order_release);
+
+		// The next connection that fails may be reconnected right away
+		resetReconnect(timeStamp);
 	}
 	/// @todo if your connection function throws exceptions that are not derived from std::system_error, but that
 	// still provide some sort of error code, you should catch those exceptions separately and wrap the error code in a custom
@@ -112,24 +283,158 @@ auto TemplateIoComponent::connect(std::chrono::system_clock::time_point timeStam
 	{
 		// Get the error from the current exception using this special utility function
 		const auto error = utils::eh::currentErrorCode();
+
+		// Close any connections that were already opened, so that the pool is never partially connected
+		closeConnections();
 		
 		// Update the state
 		updateState(timeStamp, error);
+
+		// Back off before trying again
+		scheduleReconnect(timeStamp);
 	}
 }
 
+auto TemplateIoComponent::checkKeepalive(std::chrono::system_clock::time_point timeStamp) -> void
+{
+	// Check if a probe is due
+	if (_keepaliveInterval == std::chrono::system_clock::duration::zero() || timeStamp < _nextKeepaliveTime.load(std::memory_order_relaxed))
+	{
+		return;
+	}
+	_nextKeepaliveTime.store(timeStamp + _keepaliveInterval, std::memory_order_relaxed);
+
+	try
+	{
+		// Probe all the connections in the pool
+		for (std::size_t index = 0; index < _connectionCount; ++index)
+		{
+			// Borrow the connection like any other request, so that the probe counts towards its load, and the handle stays
+			// open even if the connection is closed in the meantime
+			const HandleLease handle { _connections[index] };
+
+			/// @todo send a lightweight request the device must answer, like an echo request or a read of a single register,
+			// using *handle. If no response arrives within the keepalive interval, throw an std::system_error with
+			// CustomError::KeepaliveTimeout.
+		}
+
+		// The device is alive
+		_missedKeepalives.store(0, std::memory_order_relaxed);
+	}
+	catch (const std::exception &)
+	{
+		// Get the error from the current exception using this special utility function
+		const auto error = utils::eh::currentErrorCode();
+
+		// A single unanswered probe may just be a lost packet, so we wait for several in a row
+		if (error == CustomError::KeepaliveTimeout)
+		{
+			if (_missedKeepalives.fetch_add(1, std::memory_order_relaxed) + 1 < _keepaliveMissCount)
+			{
+				return;
+			}
+		}
+		// Any other error that does not affect the connection means that the device answered, so it is alive
+		else if (!isConnectionError(error))
+		{
+			_missedKeepalives.store(0, std::memory_order_relaxed);
+			return;
+		}
+
+		// The connection is dead. Handle this just like a connection error from a read or write.
+		_missedKeepalives.store(0, std::memory_order_relaxed);
+		handleError(timeStamp, error);
+	}
+}
+
+auto TemplateIoComponent::scheduleReconnect(std::chrono::system_clock::time_point timeStamp) -> void
+{
+	// Nothing to do if we reconnect whenever the reconnect task is executed
+	if (_reconnectDelay == std::chrono::system_clock::duration::zero())
+	{
+		return;
+	}
+
+	++_failedConnectCount;
+
+	// Double the delay for every consecutive failure
+	auto delay = backoffDelay(_reconnectDelay, _maxReconnectDelay, _failedConnectCount);
+
+	// Randomly shorten the delay by up to the jitter fraction, so that devices that failed at the same time spread out their attempts
+	std::uniform_real_distribution<double> jitter { 1.0 - _reconnectJitter, 1.0 };
+	delay = std::chrono::duration_cast<std::chrono::system_clock::duration>(delay * jitter(_jitterGenerator));
+
+	const auto nextAttempt = timeStamp + delay;
+	_nextConnectionAttempt.store(nextAttempt, std::memory_order_relaxed);
+
+	// Publish the time of the next attempt
+	memory::WriteSentinel sentinel { _reconnectDataBlock };
+	sentinel->_nextConnectionAttempt = nextAttempt;
+	sentinel.commit(timeStamp, process::StaticEventList<1>());
+}
+
+auto TemplateIoComponent::resetReconnect(std::chrono::system_clock::time_point timeStamp) -> void
+{
+	// Only update the data block if anything changes
+	if (std::exchange(_failedConnectCount, 0) == 0)
+	{
+		return;
+	}
+
+	_nextConnectionAttempt.store(std::chrono::system_clock::time_point::min(), std::memory_order_relaxed);
+
+	memory::WriteSentinel sentinel { _reconnectDataBlock };
+	sentinel->_nextConnectionAttempt = std::chrono::system_clock::time_point::min();
+	sentinel.commit(timeStamp, process::StaticEventList<1>());
+}
+
 auto TemplateIoComponent::disconnect(std::chrono::system_clock::time_point timeStamp) -> void
 {
-	// Reset the handle in any case, even if we fail, because the connection state should be false after this
-	auto handle = std::exchange(_handle, Handle());
+	std::lock_guard lock { _connectionMutex };
 
-	/// @todo close the connection, ignoring any errors. If the disconnect function can throw exceptions,
-	// these shoudl be caucht and ignored.
+	// Close the connections
+	closeConnections();
 
 	// This is always a graceful disconnect, regardless of what happened, so never include an error code.
 	updateState(timeStamp, CustomError::NotConnected);
 }
 
+auto TemplateIoComponent::closeConnections() noexcept -> void
+{
+	// Mark the component as disconnected first, so that no new requests are started on the connections we are closing
+	_connected.store(false, std::memory_order_release);
+
+	// Drop the handles from the pool. Requests that are still using a handle hold a lease that shares ownership of it, so the
+	// connection is closed by the handle's destructor once the last of these requests has finished.
+	for (std::size_t index = 0; index < _connectionCount; ++index)
+	{
+		_connections[index]._handle.store(nullptr, std::memory_order_release);
+	}
+}
+
+auto TemplateIoComponent::leaseHandle(std::size_t assignedConnection) noexcept -> HandleLease
+{
+	// Use the assigned connection, unless we are distributing the requests by load
+	auto *connection = &_connections[assignedConnection % _connectionCount];
+	if (_connectionAssignment == ConnectionAssignment::LeastLoaded)
+	{
+		// Find the connection with the fewest active requests. The counts may change while we look, but an approximate
+		// answer is good enough to spread the load.
+		auto leastActiveRequests = connection->_activeRequests.load(std::memory_order_relaxed);
+		for (std::size_t index = 0; index < _connectionCount && leastActiveRequests > 0; ++index)
+		{
+			const auto activeRequests = _connections[index]._activeRequests.load(std::memory_order_relaxed);
+			if (activeRequests < leastActiveRequests)
+			{
+				connection = &_connections[index];
+				leastActiveRequests = activeRequests;
+			}
+		}
+	}
+
+	return HandleLease(*connection);
+}
+
 auto TemplateIoComponent::updateState(std::chrono::system_clock::time_point timeStamp, std::error_code error, const ErrorSink *excludeErrorSink)
 	-> void
 {
@@ -142,7 +447,29 @@ auto TemplateIoComponent::updateState(std::chrono::system_clock::time_point time
 	// Get the old and new state
 	const auto wasConnected = !_lastError;
 	const auto connected = !error;
+	_lastError = error;
 	
+	// Collect our own events to raise
+	_stateChangeEvents.clear();
+	if (!wasConnected && connected)
+	{
+		_stateChangeEvents.push_back(_connectedEvent);
+	}
+	else if (wasConnected && !connected)
+	{
+		_stateChangeEvents.push_back(_disconnectedEvent);
+	}
+
+	// Update all error sinks in a single pass. Each sink commits its own data, but leaves its events to us, so that the
+	// events of all the sinks are raised together instead of in one burst per sink.
+	for (auto &&sink : _errorSinks)
+	{
+		if (&sink.get() != excludeErrorSink)
+		{
+			sink.get().ioComponentStateChanged(timeStamp, error, _stateChangeEvents);
+		}
+	}
+
 	// Make a write sentinel
 	memory::WriteSentinel sentinel { _stateDataBlock };
 	auto &state = *sentinel;
@@ -158,28 +485,27 @@ auto TemplateIoComponent::updateState(std::chrono::system_clock::time_point time
 	// Update the error code
 	state._error = error;
 
-	// Collect the events to raise
-	process::StaticEventList<1> events;
-	if (!wasConnected && connected)
-	{
-		events.push_back(_connectedEvent);
-	}
-	else if (wasConnected && !connected)
+	// Commit the data and raise all the events. The data of the error sinks has already been committed, so anyone handling
+	// the events sees the new state of all of them.
+	sentinel.commit(timeStamp, _stateChangeEvents);
+	_stateChangeEvents.clear();
+}
+
+auto TemplateIoComponent::acquireWrite(std::chrono::system_clock::time_point timeStamp) noexcept -> bool
+{
+	// Check the rate limit
+	if (_writeRateLimiter.tryAcquire(timeStamp))
 	{
-		events.push_back(_disconnectedEvent);
+		return true;
 	}
 
-	// Commit the data and raise the events
-	sentinel.commit(timeStamp, events);
+	// Count the throttled write
+	std::lock_guard lock { _writeRateMutex };
+	memory::WriteSentinel sentinel { _writeRateDataBlock };
+	sentinel->_throttledWriteCount = sentinel.oldValue()._throttledWriteCount + 1;
+	sentinel.commit(timeStamp, process::StaticEventList<1>());
 
-	// Notify all error sinks
-	for (auto &&sink : _errorSinks)
-	{
-		if (&sink.get() != excludeErrorSink)
-		{
-			sink.get().ioComponentStateChanged(timeStamp, error);
-		}
-	}
+	return false;
 }
 
 auto TemplateIoComponent::isConnectionError(std::error_code error) noexcept -> bool
@@ -234,12 +560,14 @@ auto TemplateIoComponent::isConnectionError(std::error_code error) noexcept -> b
 		switch (CustomError(error.value()))
 		{
 		case CustomError::NotConnected:
+		case CustomError::KeepaliveTimeout:
 		case CustomError::UnknownError:
 			/// @todo add case statements for other relevant custom errors (like e.g. timeout) here
 			return true;
 
 		case CustomError::NoError:
 		case CustomError::NoData:
+		case CustomError::ResponseTooShort:
 		default:
 			return false;
 		}
@@ -252,7 +580,7 @@ auto TemplateIoComponent::isConnectionError(std::error_code error) noexcept -> b
 	}
 }
 
-auto TemplateIoComponent::requestConnect(std::chrono::system_clock::time_point timeStamp) noexcept -> void
+auto TemplateIoComponent::requestConnect([[maybe_unused]] std::chrono::system_clock::time_point timeStamp) noexcept -> void
 {
 	// increment the count
 	const auto oldCount = _connectionRequestCount++;
@@ -260,7 +588,7 @@ auto TemplateIoComponent::requestConnect(std::chrono::system_clock::time_point t
 	// connect if the old count was 0
 	if (oldCount == 0)
 	{
-		connect(timeStamp);
+		requestConnectAttempt();
 	}
 }
 
@@ -278,6 +606,8 @@ auto TemplateIoComponent::requestDisconnect(std::chrono::system_clock::time_poin
 
 auto TemplateIoComponent::handleError(std::chrono::system_clock::time_point timeStamp, std::error_code error, const ErrorSink *sender) noexcept -> void
 {
+	std::lock_guard lock { _connectionMutex };
+
 	// Ignore any new errors if we already have an error (the first error always wins).
 	if (_lastError)
 	{
@@ -289,12 +619,16 @@ auto TemplateIoComponent::handleError(std::chrono::system_clock::time_point time
 		return;
 	}
 
-	// Reset the handle
-	/// @todo gracefully close the handle, if this is necessary
-	_handle = Handle();
+	// Close all the connections. We don't know which connection the error came from, and the pool is only ever
+	// connected as a whole.
+	closeConnections();
 
 	// update the error state
 	updateState(timeStamp, error, sender);
+
+	// Wait before the first reconnect attempt, too. Otherwise all the I/O components that lost their connection at the same time,
+	// e.g. because a switch rebooted, would reconnect in lockstep.
+	scheduleReconnect(timeStamp);
 }
 
 auto TemplateIoComponent::createChildElement(const skill::Element::Class &elementClass, skill::ElementFactory &factory)
@@ -324,7 +658,9 @@ auto TemplateIoComponent::forEachAttribute(const model::ForEachAttributeFunction
 	return
 		function(model::Attribute::kDeviceState) ||
 		function(attributes::kConnectionTime) ||
-		function(attributes::kDeviceError);
+		function(attributes::kDeviceError) ||
+		function(attributes::kThrottledWriteCount) ||
+		function(attributes::kNextConnectionAttempt);
 }
 
 auto TemplateIoComponent::forEachEvent(const model::ForEachEventFunction &function) -> bool
@@ -341,7 +677,8 @@ auto TemplateIoComponent::forEachTask(const model::ForEachTaskFunction &function
 {
 	// Handle all the tasks we support
 	return
-		function(process::Task::kReconnect, sharedFromThis(&_reconnectTask));
+		function(process::Task::kReconnect, sharedFromThis(&_reconnectTask)) ||
+		function(tasks::kRead, sharedFromThis(&_readTask));
 
 	/// @todo handle any additional tasks this class supports
 }
@@ -361,6 +698,14 @@ auto TemplateIoComponent::makeReadHandle(const model::Attribute &attribute) cons
 	{
 		return _stateDataBlock.member(&State::_error);
 	}
+	else if (attribute == attributes::kThrottledWriteCount)
+	{
+		return _writeRateDataBlock.member(&WriteRateState::_throttledWriteCount);
+	}
+	else if (attribute == attributes::kNextConnectionAttempt)
+	{
+		return _reconnectDataBlock.member(&ReconnectState::_nextConnectionAttempt);
+	}
 
 	/// @todo handle any additional readable attributes this class supports
 
@@ -370,8 +715,27 @@ auto TemplateIoComponent::makeReadHandle(const model::Attribute &attribute) cons
 
 auto TemplateIoComponent::realize() -> void
 {
-	// Create the data block
+	// Create the data blocks
 	_stateDataBlock.create(memory::memoryResources::data());
+	_writeRateDataBlock.create(memory::memoryResources::data());
+	_reconnectDataBlock.create(memory::memoryResources::data());
+}
+
+auto TemplateIoComponent::prepare() -> void
+{
+	// Reserve space for our own connected or disconnected event, and for the events of all the error sinks
+	std::size_t stateChangeEventCount { 1 };
+	for (auto &&sink : _errorSinks)
+	{
+		stateChangeEventCount += sink.get().stateChangeEventCount();
+	}
+	_stateChangeEvents.reset(stateChangeEventCount);
+
+	// Start the connect thread
+	if (!_connectThread.joinable())
+	{
+		_connectThread = std::jthread([this](std::stop_token stopToken) { connectThread(stopToken); });
+	}
 }
 
 auto TemplateIoComponent::ReconnectTask::preparePreOperational(const process::ExecutionContext &context) -> Status
@@ -3,6 +3,11 @@
 
 #include "Attributes.hpp"
 #include "CustomError.hpp"
+#include "IoComponentHandle.hpp"
+#include "RateLimiter.hpp"
+#include "Types.hpp"
+#include "ReadCoalescer.hpp"
+#include "ReadTask.hpp"
 
 #include <xentara/memory/Array.hpp>
 #include <xentara/memory/ObjectBlock.hpp>
@@ -14,8 +19,17 @@
 #include <xentara/utils/core/Uuid.hpp>
 #include <xentara/utils/tools/Unique.hpp>
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <stop_token>
 #include <string_view>
+#include <thread>
 #include <functional>
+#include <memory>
 #include <forward_list>
 
 namespace xentara::plugins::templateDriver
@@ -37,16 +51,61 @@ public:
 		"template driver I/O component">;
 
 	/// @brief A handle used to access the I/O component
-	/// @todo implement a proper handle
-	class Handle final : private utils::tools::Unique
+	using Handle = IoComponentHandle;
+
+private:
+	/// @brief A connection in the connection pool
+	struct Connection final
+	{
+		/// @brief The handle, or nullptr if the connection is closed.
+		///
+		/// Leases share ownership of the handle, so that a request that is still in flight when the connection is closed can finish
+		/// using it. The connection itself is closed when the last owner lets go of the handle.
+		std::atomic<std::shared_ptr<Handle>> _handle;
+		/// @brief The number of requests currently using the connection
+		std::atomic<std::size_t> _activeRequests { 0 };
+	};
+
+public:
+	/// @brief A handle borrowed from the connection pool for the duration of a request
+	class HandleLease final : private utils::tools::Unique
 	{
 	public:
-		/// @brief determines of the I/O component is connected
-		explicit operator bool() const noexcept
+		/// @brief Destructor. Returns the handle to the pool.
+		~HandleLease()
+		{
+			_connection.get()._activeRequests.fetch_sub(1, std::memory_order_relaxed);
+		}
+
+		/// @brief Gets the handle. If the connection was already closed when the lease was taken, this is a closed handle.
+		auto operator*() const noexcept -> const Handle &
 		{
-			/// @todo return the actual state
-			return false;
+			return _handle ? *_handle : kClosedHandle;
 		}
+
+		/// @brief Accesses the handle
+		auto operator->() const noexcept -> const Handle *
+		{
+			return &**this;
+		}
+
+	private:
+		/// @brief Constructor, called by TemplateIoComponent
+		HandleLease(std::reference_wrapper<Connection> connection) noexcept :
+			_connection(connection), _handle(connection.get()._handle.load(std::memory_order_acquire))
+		{
+			_connection.get()._activeRequests.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		/// @brief A closed handle, used if the connection was closed when the lease was taken
+		static inline const Handle kClosedHandle {};
+
+		/// @brief The connection the handle belongs to
+		std::reference_wrapper<Connection> _connection;
+		/// @brief The handle. This keeps the connection open until the lease is returned.
+		std::shared_ptr<Handle> _handle;
+
+		friend class TemplateIoComponent;
 	};
 
 	/// @brief Interface for objects that want to be notified of errors
@@ -69,8 +128,16 @@ public:
 		/// A connection was gracefully closed        | CustomError::NotConnected
 		/// The connection was lost unexpectedly      | an appropriate error code
 		///
+		/// The sink must commit its own data, but must not raise any events. Instead, it must add them to *eventsToRaise*.
+		/// The I/O component raises the events of all the sinks together, once all of them have been updated.
+		///
 		/// @todo give this a more descriptive name, e.g. "deviceStateChanged"
-		virtual auto ioComponentStateChanged(std::chrono::system_clock::time_point timeStamp, std::error_code error) -> void = 0;
+		virtual auto ioComponentStateChanged(std::chrono::system_clock::time_point timeStamp, std::error_code error,
+			PendingEventList &eventsToRaise) -> void = 0;
+
+		/// @brief Gets the maximum number of events a single call to ioComponentStateChanged() can add to the list
+		/// @note This function is called when the I/O component is prepared, after all the sinks have been realized.
+		virtual auto stateChangeEventCount() const noexcept -> std::size_t = 0;
 	};
 
 	/// @brief Adds an error sink
@@ -83,9 +150,9 @@ public:
 	///
 	/// Each call to this function must be balanced by a call to requestDisconnect().
 	/// 
-	/// If this is the first request, then the connection will be attempted, and the function will not return until
-	/// the connection has been successfully established, or has failed. In either case, error sinks will be notified,
-	/// so any error sinks calling this must be prepared to have ioComponentStateChanged() called from within this function.
+	/// If this is the first request, then the connection will be attempted by the connect thread. The function returns
+	/// immediately, without waiting for the connection to be established. Once the connection has been established or
+	/// has failed, error sinks will be notified from the connect thread.
 	auto requestConnect(std::chrono::system_clock::time_point timeStamp) noexcept -> void;
 
 	/// @brief Request that the I/O component be disconnected.
@@ -106,13 +173,61 @@ public:
 	/// @brief Checks whether the I/O component is up
 	auto connected() const -> bool
 	{
-		return bool(_handle);
+		return _connected.load(std::memory_order_acquire);
+	}
+
+	/// @brief Assigns one of the connections of the pool to an I/O transaction.
+	///
+	/// The connections are assigned round robin, so that the transactions are spread evenly across the pool.
+	/// @return The index of the connection, to be passed to leaseHandle()
+	/// @note This function must be called before the I/O component starts reading, e.g. when realizing the transaction.
+	auto assignConnection() noexcept -> std::size_t
+	{
+		return _nextAssignedConnection++ % _connectionCount;
 	}
 
-	/// @brief Returns a handle to the I/O component
-	auto handle() const -> const Handle &
+	/// @brief Borrows a handle from the connection pool to send a request
+	///
+	/// Depending on the configuration, this is either the handle of the assigned connection, or the handle of the connection
+	/// that currently has the fewest active requests.
+	/// @param assignedConnection The connection returned by assignConnection()
+	/// @return A lease for the handle. The handle must only be used while the lease exists.
+	auto leaseHandle(std::size_t assignedConnection) noexcept -> HandleLease;
+
+	/// @brief Gets the maximum number of payload bytes a single read command may request, or 0 if there is no limit.
+	auto maxPduSize() const noexcept -> std::size_t
+	{
+		return _maxPduSize;
+	}
+
+	/// @brief Asks permission to send a write request, according to the write rate limit.
+	///
+	/// If the request is not permitted, it is counted as throttled. The caller should leave its values pending, so that
+	/// they are written later, with newer values replacing older ones in the meantime.
+	/// @param timeStamp The current time
+	/// @return Returns *true* if the request may be sent
+	auto acquireWrite(std::chrono::system_clock::time_point timeStamp) noexcept -> bool;
+
+	/// @brief Accounts for additional write requests that were sent after acquireWrite() permitted the first one
+	/// @param timeStamp The current time
+	/// @param requestCount The number of additional requests
+	auto chargeWrites(std::chrono::system_clock::time_point timeStamp, std::size_t requestCount) noexcept -> void
 	{
-		return _handle;
+		_writeRateLimiter.charge(timeStamp, requestCount);
+	}
+
+	/// @brief Adds an I/O transaction whose reads should be coalesced with those of other transactions
+	/// @note This function must be called before the I/O component starts reading, e.g. when realizing the transaction.
+	auto addCoalescedReader(std::reference_wrapper<ReadCoalescer::Client> reader) -> void
+	{
+		_readCoalescer.addClient(reader);
+	}
+
+	/// @brief Requests that the data of an I/O transaction be read the next time the "read" task of the I/O component is executed.
+	/// @param reader The transaction. It must have been added using addCoalescedReader().
+	auto requestCoalescedRead(ReadCoalescer::Client &reader) noexcept -> void
+	{
+		ReadCoalescer::requestRead(reader);
 	}
 
 	/// @name Virtual Overrides for skill::Element
@@ -137,6 +252,18 @@ public:
 	/// @}
 
 private:
+	// The read task needs access to out private member functions
+	friend class ReadTask<TemplateIoComponent>;
+
+	/// @brief How I/O transactions are distributed across the connection pool
+	enum class ConnectionAssignment
+	{
+		/// @brief Each transaction always uses the same connection
+		Sticky,
+		/// @brief Each request uses the connection with the fewest active requests
+		LeastLoaded
+	};
+
 	/// @brief This structure represents the current state of the I/O component
 	struct State
 	{
@@ -148,6 +275,20 @@ private:
 		std::error_code _error { CustomError::NotConnected };
 	};
 
+	/// @brief This structure represents the statistics of the write rate limit
+	struct WriteRateState
+	{
+		/// @brief The number of writes that were deferred because of the rate limit
+		std::uint64_t _throttledWriteCount { 0 };
+	};
+
+	/// @brief This structure represents the state of the reconnect backoff
+	struct ReconnectState
+	{
+		/// @brief The earliest time the next connection attempt will be made
+		std::chrono::system_clock::time_point _nextConnectionAttempt { std::chrono::system_clock::time_point::min() };
+	};
+
 	/// @brief This class providing callbacks for the Xentara scheduler for the "reconnect" task
 	class ReconnectTask final : public process::Task
 	{
@@ -189,16 +330,58 @@ private:
 	/// This function attempts to reconnect any disconnected I/O components.
 	auto performReconnectTask(const process::ExecutionContext &context) -> void;
 
+	/// @brief This function is called by the "read" task.
+	///
+	/// This function performs the coalesced reads of all I/O transactions that requested one since the last call.
+	auto performReadTask(const process::ExecutionContext &context) -> void;
+
+	/// @brief Asks the connect thread to attempt a connection
+	auto requestConnectAttempt() noexcept -> void
+	{
+		if (!_connectAttemptRequested.exchange(true, std::memory_order_acq_rel))
+		{
+			_connectAttemptRequested.notify_one();
+		}
+	}
+
+	/// @brief The function executed by the connect thread.
+	///
+	/// The thread sleeps until a connection attempt is requested, and then attempts to connect, so that an unreachable
+	/// device does not block the threads the tasks are executed on.
+	auto connectThread(std::stop_token stopToken) -> void;
+
 	/// @brief Attempts to establish a connection to the I/O component and updates the state accordingly.
 	///
 	/// This function will notify error sinks if anything changes.
+	/// @note This function is only called by the connect thread.
 	auto connect(std::chrono::system_clock::time_point timeStamp) -> void;
 
+	/// @brief Probes the connections if the keepalive interval has elapsed, and handles a dead connection like any other connection error
+	/// @param timeStamp The current time
+	auto checkKeepalive(std::chrono::system_clock::time_point timeStamp) -> void;
+
+	/// @brief Schedules the next connection attempt after a failed one or after the connection was lost, and publishes its time
+	///
+	/// This does nothing if no reconnect delay was configured.
+	/// @param timeStamp The time of the failure
+	/// @note This function must be called with _connectionMutex held.
+	auto scheduleReconnect(std::chrono::system_clock::time_point timeStamp) -> void;
+
+	/// @brief Allows the next connection attempt to be made right away, and publishes this
+	/// @param timeStamp The current time
+	/// @note This function must be called with _connectionMutex held.
+	auto resetReconnect(std::chrono::system_clock::time_point timeStamp) -> void;
+
 	/// @brief Terminates the connection to the I/O component and updates the state accordingly.
 	///
 	/// This function will notify error sinks if anything changes.
 	auto disconnect(std::chrono::system_clock::time_point timeStamp) -> void;
 
+	/// @brief Closes all the connections in the pool, ignoring any errors
+	///
+	/// Connections that are still in use by a request are closed as soon as the request returns its lease.
+	auto closeConnections() noexcept -> void;
+
 	/// @brief Updates the state and sends events
 	auto updateState(std::chrono::system_clock::time_point timeStamp, std::error_code error, const ErrorSink *excludeErrorSink = nullptr) -> void;
 
@@ -212,6 +395,8 @@ private:
 
 	auto realize() -> void final;
 
+	auto prepare() -> void final;
+
 	/// @}
 
 	/// @brief A Xentara event that is raised when the connection is established
@@ -221,15 +406,84 @@ private:
 
 	/// @brief The "reconnect" task
 	ReconnectTask _reconnectTask { *this };
+	/// @brief The "read" task, which performs the coalesced reads
+	ReadTask<TemplateIoComponent> _readTask { *this };
+
+	/// @brief The object that merges the reads of several I/O transactions
+	ReadCoalescer _readCoalescer;
 
 	/// @brief A list of objects that want to be notified of errors
 	std::forward_list<std::reference_wrapper<ErrorSink>> _errorSinks;
+	/// @brief The events to raise when the state changes, including those of all the error sinks.
+	///
+	/// This is only used by updateState(), and is protected by _connectionMutex.
+	PendingEventList _stateChangeEvents;
+
+	/// @brief The maximum number of payload bytes a single read command may request, or 0 if there is no limit.
+	/// @todo use the correct default for the protocol
+	std::size_t _maxPduSize { 0 };
+
+	/// @brief The maximum number of write requests per second, or 0 for no limit
+	double _maxWriteRate { 0 };
+	/// @brief The maximum number of write requests that may be sent at once
+	std::size_t _writeBurst { 1 };
+	/// @brief The token bucket that enforces the write rate limit
+	RateLimiter _writeRateLimiter;
+	/// @brief A mutex protecting the write rate data block, since throttled writes may be counted from several threads at once
+	std::mutex _writeRateMutex;
+
+	/// @brief How long to wait for a connection to be established
+	/// @todo use the correct default for the protocol
+	std::chrono::system_clock::duration _connectTimeout { std::chrono::seconds(5) };
+	/// @brief The delay before the first reconnect attempt after a failed connection or a lost connection, or 0 to attempt a
+	/// reconnect whenever the "reconnect" task is executed.
+	///
+	/// The delay doubles with every consecutive failed attempt, up to _maxReconnectDelay.
+	std::chrono::system_clock::duration _reconnectDelay { 0 };
+	/// @brief The maximum delay between reconnect attempts
+	std::chrono::system_clock::duration _maxReconnectDelay { std::chrono::minutes(1) };
+	/// @brief The fraction of the delay that is randomized, so that many devices don't all reconnect at the same time
+	double _reconnectJitter { 0.5 };
+	/// @brief The number of consecutive failed connection attempts
+	std::size_t _failedConnectCount { 0 };
+	/// @brief The random number generator used for the jitter
+	std::minstd_rand _jitterGenerator { std::random_device()() };
+	/// @brief The earliest time the next reconnect may be attempted
+	std::atomic<std::chrono::system_clock::time_point> _nextConnectionAttempt { std::chrono::system_clock::time_point::min() };
+
+	/// @brief The interval between keepalive probes, or 0 to not send any
+	std::chrono::system_clock::duration _keepaliveInterval { 0 };
+	/// @brief The number of consecutive keepalive probes that may go unanswered before the connection is considered dead
+	std::size_t _keepaliveMissCount { 3 };
+	/// @brief The number of consecutive keepalive probes that went unanswered
+	///
+	/// This is atomic, because it is reset by the connect thread, but updated by the thread executing the reconnect task.
+	std::atomic<std::size_t> _missedKeepalives { 0 };
+	/// @brief The time the next keepalive probe is due
+	///
+	/// This is atomic for the same reason as _missedKeepalives.
+	std::atomic<std::chrono::system_clock::time_point> _nextKeepaliveTime;
+
+	/// @brief Set when the connect thread should attempt a connection
+	std::atomic<bool> _connectAttemptRequested { false };
+	/// @brief A mutex that serializes connecting, disconnecting, and handling connection errors, which happen on different threads
+	std::mutex _connectionMutex;
 
 	/// @brief The number of people who would like this component to be connected
 	std::atomic<std::size_t> _connectionRequestCount { 0 };
 
-	/// @brief A handle to the I/O component
-	Handle _handle;
+	/// @brief The number of connections in the pool
+	std::size_t _connectionCount { 1 };
+	/// @brief How I/O transactions are distributed across the connections
+	ConnectionAssignment _connectionAssignment { ConnectionAssignment::Sticky };
+	/// @brief The connection that will be assigned to the next I/O transaction
+	std::size_t _nextAssignedConnection { 0 };
+	/// @brief The connections to the I/O component.
+	///
+	/// The connections are opened and closed together, so that the I/O component has a single connection state.
+	std::unique_ptr<Connection[]> _connections;
+	/// @brief Whether all the connections are open
+	std::atomic<bool> _connected { false };
 	/// @brief The last error we encountered.
 	/// 
 	/// May have the following values:
@@ -240,6 +494,14 @@ private:
 
 	/// @brief The data block that contains the state
 	memory::ObjectBlock<State> _stateDataBlock;
+	/// @brief The data block that contains the write rate statistics
+	memory::ObjectBlock<WriteRateState> _writeRateDataBlock;
+	/// @brief The data block that contains the state of the reconnect backoff
+	memory::ObjectBlock<ReconnectState> _reconnectDataBlock;
+
+	/// @brief The thread that establishes the connections
+	/// @note This must be the last data member, so that the thread is stopped before any of the data it uses is destroyed.
+	std::jthread _connectThread;
 };
 
 inline TemplateIoComponent::ErrorSink::~ErrorSink() = default;
@@ -2,6 +2,7 @@
 #include "TemplateIoTransaction.hpp"
 
 #include "Attributes.hpp"
+#include "Backoff.hpp"
 #include "Tasks.hpp"
 #include "TemplateInput.hpp"
 #include "TemplateOutput.hpp"
@@ -22,6 +23,12 @@
 #include <xentara/utils/json/decoder/Errors.hpp>
 #include <xentara/utils/eh/currentErrorCode.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <system_error>
+
 namespace xentara::plugins::templateDriver
 {
 
@@ -54,8 +61,64 @@ auto TemplateIoTransaction::load(utils::json::decoder::Object &jsonObject, confi
 	bool ioTransactionLoaded = false;
 	for (auto && [name, value] : jsonObject)
     {
+		if (name == "asyncRead"sv)
+		{
+			_asyncRead = value.asBool();
+		}
+		else if (name == "readTimeout"sv)
+		{
+			_readTimeout = std::chrono::milliseconds(value.asNumber<std::uint64_t>());
+			if (_readTimeout <= std::chrono::system_clock::duration::zero())
+			{
+				utils::json::decoder::throwWithLocation(value, std::runtime_error("read timeout must be positive in template I/O transaction"));
+			}
+		}
+		else if (name == "coalesceReads"sv)
+		{
+			_coalesceReads = value.asBool();
+		}
+		else if (name == "address"sv)
+		{
+			_baseAddress = value.asNumber<std::size_t>();
+		}
+		else if (name == "maxAge"sv)
+		{
+			_maxAge = std::chrono::milliseconds(value.asNumber<std::uint64_t>());
+		}
+		else if (name == "writeGapTolerance"sv)
+		{
+			_writeGapTolerance = value.asNumber<std::size_t>();
+		}
+		else if (name == "writeRetryDelay"sv)
+		{
+			_writeRetryDelay = std::chrono::milliseconds(value.asNumber<std::uint64_t>());
+		}
+		else if (name == "maxWriteRetryDelay"sv)
+		{
+			_maxWriteRetryDelay = std::chrono::milliseconds(value.asNumber<std::uint64_t>());
+		}
+		else if (name == "writeThrough"sv)
+		{
+			_writeThrough = value.asBool();
+		}
+		else if (name == "valueLayout"sv)
+		{
+			const auto layout = value.asString<std::string>();
+			if (layout == "interleaved"sv)
+			{
+				_valueLayout = ValueLayout::Interleaved;
+			}
+			else if (layout == "contiguous"sv)
+			{
+				_valueLayout = ValueLayout::Contiguous;
+			}
+			else
+			{
+				utils::json::decoder::throwWithLocation(value, std::runtime_error("unknown value layout in template I/O transaction"));
+			}
+		}
 		/// @todo load configuration parameters
-		if (name == "TODO"sv)
+		else if (name == "TODO"sv)
 		{
 			/// @todo parse the value correctly
 			auto todo = value.asNumber<std::uint64_t>();
@@ -75,6 +138,18 @@ auto TemplateIoTransaction::load(utils::json::decoder::Object &jsonObject, confi
 		}
     }
 
+	// Coalesced reads are always performed synchronously by the I/O component
+	if (_coalesceReads && _asyncRead)
+	{
+		utils::json::decoder::throwWithLocation(jsonObject,
+			std::runtime_error("asynchronous reads cannot be coalesced in template I/O transaction"));
+	}
+	// Coalesced payloads live in a buffer belonging to the I/O component, so they cannot be kept around for reuse
+	if (_coalesceReads && _maxAge != std::chrono::system_clock::duration::zero())
+	{
+		utils::json::decoder::throwWithLocation(jsonObject,
+			std::runtime_error("a maximum payload age cannot be used with coalesced reads in template I/O transaction"));
+	}
 	/// @todo perform consistency and completeness checks
 	if (!"TODO")
 	{
@@ -96,7 +171,7 @@ auto TemplateIoTransaction::addInput(std::reference_wrapper<AbstractInput> input
 	_inputs.push_back(input);
 }
 
-auto TemplateIoTransaction::addOutput(std::reference_wrapper<AbstractOutput> output) -> void
+auto TemplateIoTransaction::addOutput(std::reference_wrapper<AbstractOutput> output) -> std::size_t
 {
 	// Make sure we belong to the same I/O component
 	if (&output.get().ioComponent() != &_ioComponent.get())
@@ -107,6 +182,7 @@ auto TemplateIoTransaction::addOutput(std::reference_wrapper<AbstractOutput> out
 
 	// Add it
 	_outputs.push_back(output);
+	return _outputs.size() - 1;
 }
 
 auto TemplateIoTransaction::forEachAttribute(const model::ForEachAttributeFunction &function) const -> bool
@@ -136,7 +212,8 @@ auto TemplateIoTransaction::forEachTask(const model::ForEachTaskFunction &functi
 	// Handle all the tasks we support
 	return
 		function(tasks::kRead, sharedFromThis(&_readTask)) ||
-		function(tasks::kWrite, sharedFromThis(&_writeTask));
+		function(tasks::kWrite, sharedFromThis(&_writeTask)) ||
+		function(tasks::kRelease, sharedFromThis(&_releaseTask));
 
 	/// @todo handle any additional tasks this class supports
 }
@@ -185,44 +262,120 @@ auto TemplateIoTransaction::realize() -> void
 	_readState.attach(_readDataArray, readEventCount);
 	_writeState.attach(_writeDataArray, writeEventCount);
 
-	// Attach all the inputs
+	// Attach all the inputs by building the decode plan
 	for (auto &&input : _inputs)
 	{
-		input.get().attachInput(_readDataArray, readEventCount);
+		input.get().addToDecodePlan(_decodePlan);
+	}
+	_decodePlan.attach(_readDataArray, readEventCount, _valueLayout);
+
+	// Create one read command for each part of the payload that fits into a single PDU. This is done here rather than in prepare(),
+	// so that the read coalescer can size its buffers for our commands when we are added to it.
+	/// @todo initialized the read commands properly based on the inputs to read.
+	_readCommands.clear();
+	for (auto &&range : _decodePlan.partition(_ioComponent.get().maxPduSize()))
+	{
+		_readCommands.push_back(std::make_unique<ReadCommand>(range._offset, range._size));
 	}
+	_pendingCommandErrors.resize(_readCommands.size());
+
+	// Let the I/O component coalesce our reads, if requested
+	if (_coalesceReads)
+	{
+		_ioComponent.get().addCoalescedReader(*this);
+	}
+	// Get a connection to use
+	_assignedConnection = _ioComponent.get().assignConnection();
 	// Attach all the outputs
+	_outputWriteStates.clear();
 	for (auto &&output : _outputs)
 	{
 		output.get().attachOutput(_writeDataArray, writeEventCount);
+		output.get().attachWriteGroup(_writeGroup);
+		_outputWriteStates.push_back(output.get().writeState());
+		_readBackWrites = _readBackWrites || output.get().readsBackWrites();
 	}
+	_writeGroup.allocate();
 
 	// Create the data blocks
 	_readDataBlock.create(memory::memoryResources::data());
 	_writeDataBlock.create(memory::memoryResources::data());
 
 	// Reserve space in the buffers
-	_runtimeBuffers._eventsToRaise.reset(std::max(readEventCount, writeEventCount));
+	_runtimeBuffers._eventsToRaise.reset(readEventCount);
+	_readEventCount = readEventCount;
+	_runtimeBuffers._writeEventsToRaise.reset(writeEventCount);
 	_runtimeBuffers._outputsToNotify.reset(_outputs.size());
+	// Create the bitmaps of pending outputs and outputs to retry
+	_pendingOutputs.reset(_outputs.size());
+	_retryOutputs.reset(_outputs.size());
+	// Preallocate the write command
+	std::size_t writeValueCount { 0 };
+	std::size_t writeDataSize { 0 };
+	for (auto &&output : _outputs)
+	{
+		output.get().addWriteCapacity(writeValueCount, writeDataSize);
+	}
+	_runtimeBuffers._writeCommand.reset(writeValueCount, writeDataSize, _writeGapTolerance, _ioComponent.get().maxPduSize());
 }
 
 auto TemplateIoTransaction::prepare() -> void
 {
-	// Create a read command
-	/// @todo initialized the read command properly based on the inputs to read.
-	_readCommand.reset(new ReadCommand);
+	// Determine how much data we need to receive to decode all the inputs
+	const auto payloadSize = _decodePlan.payloadSize();
+
+	// Preallocate the receive buffers. We only ever have a single set of read commands outstanding, but we keep the last payload
+	// around to compare it with the next one, so we need two buffers. The responses to all the read commands are received into
+	// the same buffer.
+	_receiveBuffers.reset(2, payloadSize);
+	_lastPayload = {};
 
-	/// @todo provide the information needed to decode the value to the inputs, like e.g. the correct data data offsets.
+	// Start the write-through thread, if requested
+	if (_writeThrough && !_writeThroughThread.joinable())
+	{
+		_writeThroughThread = std::jthread([this](std::stop_token stopToken) { writeThroughThread(stopToken); });
+	}
 }
 
-auto TemplateIoTransaction::ioComponentStateChanged(std::chrono::system_clock::time_point timeStamp, std::error_code error) -> void
+auto TemplateIoTransaction::ioComponentStateChanged(std::chrono::system_clock::time_point timeStamp, std::error_code error,
+	PendingEventList &eventsToRaise) -> void
 {
 	// We cannot reset the error to Ok because we don't have a read command payload. So we use the special custom error code instead.
 	auto effectiveError = error ? error : CustomError::NoData;
 
+	// The device may have been restarted or changed while the connection was down, so the outputs can no longer be sure
+	// which values it has.
+	for (auto &&output : _outputs)
+	{
+		output.get().forgetWrittenValue();
+	}
+
+	// Responses to outstanding asynchronous read commands may never arrive now, so we stop waiting for them. Otherwise
+	// no new commands would ever be submitted.
+	if (error)
+	{
+		abandonPendingRead();
+	}
+
+	// Check the error and update the inputs under the same lock, so that a read completing on another thread cannot change
+	// the error in between.
+	std::lock_guard lock { _inputMutex };
+
+	// If the inputs already have this error, updating them again would change nothing but the update time. Skipping them saves
+	// a commit and a burst of events for every transaction that is already invalid, e.g. because its own read failed first.
+	if (effectiveError == _inputError)
+	{
+		return;
+	}
+
 	// Update the inputs. We do not notify the I/O component, because that is who this message comes from in the first place.
 	// Note: the write state is not updated, because the write state simply contains the last write error, which is unaffected
 	// by I/O component errors.
-	updateInputs(timeStamp, utils::eh::unexpected(effectiveError));
+	WriteSentinel sentinel { _readDataBlock };
+	stageInputs(sentinel, timeStamp, utils::eh::unexpected(effectiveError), false, eventsToRaise);
+
+	// Commit the data, but leave the events to the I/O component, which raises them together with those of the other transactions
+	sentinel.commit(timeStamp, process::StaticEventList<1>());
 }
 
 auto TemplateIoTransaction::performReadTask(const process::ExecutionContext &context) -> void
@@ -233,22 +386,81 @@ auto TemplateIoTransaction::performReadTask(const process::ExecutionContext &con
 		return;
 	}
 
-	// Read the data
-	read(context.scheduledTime());
+	const auto timeStamp = context.scheduledTime();
+
+	// Read the data ourselves. The lock is held for the entire read, so that other pipelines triggering the task at the same time
+	// wait for the result, and can reuse it.
+	if (!_coalesceReads && !_asyncRead)
+	{
+		std::lock_guard lock { _readMutex };
+		if (!reuseLastPayload(timeStamp))
+		{
+			read(timeStamp);
+		}
+		return;
+	}
+
+	// Reuse the last payload if it is recent enough
+	{
+		std::lock_guard lock { _readMutex };
+		if (reuseLastPayload(timeStamp))
+		{
+			return;
+		}
+	}
+
+	// Have the I/O component read the data together with that of other transactions, or just submit the read command
+	// if the response is processed asynchronously
+	if (_coalesceReads)
+	{
+		// The coalesced read starts after this, so it will reflect all the writes made so far
+		{
+			std::lock_guard lock { _readMutex };
+			_readStartWriteCount.store(_writeCount.load(std::memory_order_acquire), std::memory_order_relaxed);
+		}
+		_ioComponent.get().requestCoalescedRead(*this);
+	}
+	else
+	{
+		submitRead(timeStamp);
+	}
 }
 
 auto TemplateIoTransaction::read(std::chrono::system_clock::time_point timeStamp) -> void
 {
 	try
 	{
-		/// @todo send the read command
-		ReadCommand::Payload payload = {};
+		// Get a buffer to receive the responses into
+		const auto receiveBuffer = _receiveBuffers.acquire();
+		// Remember which writes the payload can reflect
+		_readStartWriteCount.store(_writeCount.load(std::memory_order_acquire), std::memory_order_relaxed);
+		// Borrow a connection to send the commands on
+		const auto handle = _ioComponent.get().leaseHandle(_assignedConnection);
+
+		// Send the read commands back to back
+		/// @todo if the protocol allows pipelining, send all the commands before receiving any responses
+		for (auto &&command : _readCommands)
+		{
+			// Get the part of the buffer to receive the response into
+			const auto responseBuffer = command->responseBuffer(receiveBuffer);
+
+			/// @todo send the read command using *handle and receive the response directly into responseBuffer, and set responseSize to the
+			// number of bytes actually received.
+			std::size_t responseSize = responseBuffer.size();
+
+			/// @todo if the read function does not throw errors, but uses return types or internal handle state,
+			// throw an std::system_error here on failure, or call handleReadError() directly.
 
-		/// @todo if the read function does not throw errors, but uses return types or internal handle state,
-		// throw an std::system_error here on failure, or call handleReadError() directly.
+			// Make sure we received enough data
+			if (const auto error = command->validateResponse(responseSize))
+			{
+				throw std::system_error(error);
+			}
+		}
 
-		// The read was successful
-		updateInputs(timeStamp, payload);
+		// The read was successful. Update all the inputs at once from the assembled payload.
+		const ReadCommand::Payload payload { receiveBuffer };
+		updateInputs(timeStamp, payload, true);
 	}
 	catch (const std::exception &)
 	{
@@ -259,11 +471,202 @@ auto TemplateIoTransaction::read(std::chrono::system_clock::time_point timeStamp
 	}
 }
 
+auto TemplateIoTransaction::submitRead(std::chrono::system_clock::time_point timeStamp) -> void
+{
+	const auto commandCount = _readCommands.size();
+	std::size_t readId = 0;
+	bool overdue = false;
+	{
+		std::lock_guard lock { _pendingReadMutex };
+
+		// Don't submit more commands if the last ones are still outstanding. The responses to the outstanding commands
+		// will update the inputs with fresh data soon enough, unless they are overdue.
+		if (_readPending)
+		{
+			if (timeStamp - _pendingReadTime < _readTimeout)
+			{
+				return;
+			}
+			overdue = true;
+		}
+		// Set up the new commands
+		else
+		{
+			_readPending = true;
+			readId = ++_pendingReadId;
+			_pendingCommandCount = commandCount;
+			// Remember the time stamp for when the responses arrive, and which writes the payload can reflect
+			_pendingReadTime = timeStamp;
+			_readStartWriteCount.store(_writeCount.load(std::memory_order_acquire), std::memory_order_relaxed);
+			// Get a buffer to receive the responses into
+			_pendingReceiveBuffer = _receiveBuffers.acquire();
+		}
+	}
+
+	// If the outstanding commands are overdue, give up on them and report the timeout. New commands are submitted
+	// the next time the read task is executed.
+	if (overdue)
+	{
+		abandonPendingRead();
+		std::lock_guard lock { _readMutex };
+		handleReadError(timeStamp, std::make_error_code(std::errc::timed_out));
+		return;
+	}
+
+	// If there are no commands, we are done
+	if (commandCount == 0)
+	{
+		finishReadCommands(readId, 0, 0, {});
+		return;
+	}
+
+	// Borrow a connection to submit the commands on
+	const auto handle = _ioComponent.get().leaseHandle(_assignedConnection);
+
+	// Submit the commands back to back
+	for (std::size_t commandIndex = 0; commandIndex < commandCount; ++commandIndex)
+	{
+		try
+		{
+			/// @todo submit the read command using *handle without waiting for the response, and arrange for the response to be received directly
+			// into _readCommands[commandIndex]->responseBuffer(_pendingReceiveBuffer), and for readCompleted() to be called
+			// with readId and commandIndex once the response has arrived, or the command has failed.
+		}
+		catch (const std::exception &)
+		{
+			// Get the error from the current exception using this special utility function
+			const auto error = utils::eh::currentErrorCode();
+			// This command and all the following ones will never be submitted, so finish them here
+			finishReadCommands(readId, commandIndex, commandCount - commandIndex, error);
+			return;
+		}
+	}
+}
+
+auto TemplateIoTransaction::readCompleted(std::size_t readId,
+	std::size_t commandIndex,
+	const utils::eh::expected<std::size_t, std::error_code> &responseSizeOrError) -> void
+{
+	// Determine the outcome of the command
+	const auto error = responseSizeOrError ? _readCommands[commandIndex]->validateResponse(*responseSizeOrError)
+										   : responseSizeOrError.error();
+
+	finishReadCommands(readId, commandIndex, 1, error);
+}
+
+auto TemplateIoTransaction::finishReadCommands(std::size_t readId, std::size_t commandIndex, std::size_t commandCount, std::error_code error)
+	-> void
+{
+	std::error_code readError;
+	std::chrono::system_clock::time_point timeStamp;
+	std::span<const std::byte> receiveBuffer;
+	{
+		std::lock_guard lock { _pendingReadMutex };
+
+		// Ignore responses to commands that were abandoned
+		if (readId != _pendingReadId)
+		{
+			return;
+		}
+
+		// Record the outcome of the commands, and wait for the remaining ones
+		std::fill_n(_pendingCommandErrors.begin() + commandIndex, commandCount, error);
+		_pendingCommandCount -= commandCount;
+		if (_pendingCommandCount > 0)
+		{
+			return;
+		}
+
+		// Find the first error, if any
+		const auto failed = std::ranges::find_if(_pendingCommandErrors, [](const std::error_code &error) { return bool(error); });
+		readError = failed != _pendingCommandErrors.end() ? *failed : std::error_code();
+		timeStamp = _pendingReadTime;
+		receiveBuffer = _pendingReceiveBuffer;
+	}
+
+	{
+		// Protect against concurrent reads from the read task
+		std::lock_guard readLock { _readMutex };
+		std::unique_lock inputLock { _inputMutex };
+
+		// Drop the result if the commands were abandoned while we were waiting for the locks, e.g. because the connection was lost
+		// and the inputs were invalidated. Otherwise, we would make them valid again.
+		if (!isPendingRead(readId))
+		{
+			return;
+		}
+
+		// The read was successful. Update all the inputs at once from the assembled payload.
+		if (!readError)
+		{
+			const ReadCommand::Payload payload { receiveBuffer };
+			updateInputsLocked(timeStamp, payload, true);
+		}
+		// Handle the error. The input lock must be released before notifying the I/O component, because the I/O component
+		// invalidates the inputs of the other transactions while holding its own lock.
+		else
+		{
+			updateInputsLocked(timeStamp, utils::eh::unexpected(readError), false);
+			inputLock.unlock();
+			_ioComponent.get().handleError(timeStamp, readError, this);
+		}
+	}
+
+	// Allow the next commands to be submitted, unless this has already happened because the commands were abandoned
+	std::lock_guard lock { _pendingReadMutex };
+	if (readId == _pendingReadId)
+	{
+		_readPending = false;
+	}
+}
+
+auto TemplateIoTransaction::isPendingRead(std::size_t readId) noexcept -> bool
+{
+	std::lock_guard lock { _pendingReadMutex };
+	return _readPending && readId == _pendingReadId;
+}
+
+auto TemplateIoTransaction::abandonPendingRead() noexcept -> void
+{
+	std::lock_guard lock { _pendingReadMutex };
+	if (!_readPending)
+	{
+		return;
+	}
+
+	// Changing the ID makes any late responses be ignored
+	++_pendingReadId;
+	_readPending = false;
+	_pendingReceiveBuffer = {};
+
+	/// @todo cancel the outstanding read commands, if the protocol supports it
+}
+
+auto TemplateIoTransaction::coalescedReadCompleted(std::chrono::system_clock::time_point timeStamp,
+	const utils::eh::expected<std::reference_wrapper<const ReadCommand::Payload>, std::error_code> &payloadOrError) -> void
+{
+	// Protect against concurrent reads from the read task
+	std::lock_guard lock { _readMutex };
+
+	// Check if the read was successful
+	if (payloadOrError)
+	{
+		// The payload refers to a buffer belonging to the I/O component, which may be overwritten or reallocated at any time,
+		// so it is not remembered as the last payload.
+		updateInputs(timeStamp, payloadOrError, false);
+	}
+	// If a connection error caused another transaction to disconnect the I/O component, we were already invalidated
+	else if (_ioComponent.get().connected())
+	{
+		handleReadError(timeStamp, payloadOrError.error());
+	}
+}
+
 auto TemplateIoTransaction::handleReadError(std::chrono::system_clock::time_point timeStamp, std::error_code error)
 	-> void
 {
 	// Update our own state together with those of the inputs
-	updateInputs(timeStamp, utils::eh::unexpected(error));
+	updateInputs(timeStamp, utils::eh::unexpected(error), false);
 	// Notify the I/O component
 	_ioComponent.get().handleError(timeStamp, error, this);
 }
@@ -280,23 +683,51 @@ auto TemplateIoTransaction::performWriteTask(const process::ExecutionContext &co
 	write(context.scheduledTime());
 }
 
+auto TemplateIoTransaction::performReleaseTask([[maybe_unused]] const process::ExecutionContext &context) -> void
+{
+	// Release the staged values, and write them right away if requested
+	if (_writeGroup.release())
+	{
+		requestWriteThrough();
+	}
+}
+
 auto TemplateIoTransaction::write(std::chrono::system_clock::time_point timeStamp) -> void
 {
-	// Protect use of the list of outputs to notify
+	// The write task and the write-through thread must not write at the same time
+	std::lock_guard lock { _writeMutex };
+
+	// Protect use of the list of outputs to notify and the command
 	RuntimeBufferSentinel eventsToRaiseSentinel(_runtimeBuffers._outputsToNotify);
+	RuntimeBufferSentinel commandSentinel(_runtimeBuffers._writeCommand);
+	auto &command = _runtimeBuffers._writeCommand;
 
-	// Create a command
-	WriteCommand command;
+	// Give the outputs whose last write failed another chance, once the retry delay has elapsed. If the outputs have
+	// new values by then, the new values are written instead.
+	if (timeStamp >= _nextWriteRetryTime)
+	{
+		_retryOutputs.consume([this](std::size_t outputIndex) { _pendingOutputs.mark(outputIndex); });
+	}
 
-	// Collect pending outputs
-	for (auto &&output : _outputs)
+	// Pick up the values released from the write group, if the last ones have all been written
+	_writeGroup.acquire([this](std::size_t outputIndex) { _pendingOutputs.mark(outputIndex); });
+
+	// If there are pending outputs, make sure we are not writing too often. If we are, we leave the outputs pending,
+	// so that they will be written by a later write, with any newer values replacing the current ones.
+	if (!_pendingOutputs.any() || !_ioComponent.get().acquireWrite(timeStamp))
 	{
-		// Add the output
+		return;
+	}
+
+	// Collect the outputs that were marked as pending
+	_pendingOutputs.consume([&](std::size_t outputIndex) {
+		const auto &output = _outputs[outputIndex];
+		// Add the output. This may still find no values, if they were already added by the previous write.
 		if (output.get().addToWriteCommand(command))
 		{
 			_runtimeBuffers._outputsToNotify.push_back(output);
 		}
-	}
+	});
 
 	// If there were no pending outputs, just bail
 	if (_runtimeBuffers._outputsToNotify.empty())
@@ -304,23 +735,128 @@ auto TemplateIoTransaction::write(std::chrono::system_clock::time_point timeStam
 		return;
 	}
 
+	// Merge the values into as few ranges as possible
+	const auto ranges = command.merge([this](std::size_t offset, std::span<std::byte> gap) { return fillWriteGap(offset, gap); });
+	// Account for the additional requests, since we only asked permission for one
+	if (ranges.size() > 1)
+	{
+		_ioComponent.get().chargeWrites(timeStamp, ranges.size() - 1);
+	}
+
 	try
 	{
-		/// @todo send the command
+		// Borrow a connection to send the requests on
+		const auto handle = _ioComponent.get().leaseHandle(_assignedConnection);
+
+		for ([[maybe_unused]] auto &&range : ranges)
+		{
+			/// @todo send a write request for the range using *handle. The address of the range is relative to the base address of the transaction.
+		}
 
 		/// @todo if the write function does not throw errors, but uses return types or internal handle state,
 		// throw an std::system_error here on failure, or call handleWriteError() directly.
 
 		// The write was successful
+		_failedWriteCount = 0;
 		updateOutputs(timeStamp, std::error_code(), _runtimeBuffers._outputsToNotify);
+		// Show the written values right away, instead of waiting for the next read
+		if (_readBackWrites)
+		{
+			updateReadBack(timeStamp, _runtimeBuffers._outputsToNotify);
+		}
 	}
 	catch (const std::exception &)
 	{
 		// Get the error from the current exception using this special utility function
 		const auto error = utils::eh::currentErrorCode();
+		// Back off before retrying the values
+		scheduleWriteRetry(timeStamp);
 		// Handle the error
 		handleWriteError(timeStamp, error, _runtimeBuffers._outputsToNotify);
 	}
+
+	// Payloads read before this point may not reflect what we just wrote, even if the write failed part way through
+	_writeCount.fetch_add(1, std::memory_order_release);
+}
+
+auto TemplateIoTransaction::scheduleWriteRetry(std::chrono::system_clock::time_point timeStamp) -> void
+{
+	// Nothing to do if retries are disabled
+	if (!writeRetriesEnabled())
+	{
+		return;
+	}
+
+	++_failedWriteCount;
+
+	// Double the delay for every consecutive failure
+	_nextWriteRetryTime = timeStamp + backoffDelay(_writeRetryDelay, _maxWriteRetryDelay, _failedWriteCount);
+}
+
+auto TemplateIoTransaction::fillWriteGap(std::size_t offset, std::span<std::byte> gap) -> bool
+{
+	// Don't wait for a read in progress, as this would delay the write by an entire round trip
+	std::unique_lock lock { _readMutex, std::try_to_lock };
+	if (!lock.owns_lock())
+	{
+		return false;
+	}
+
+	// Protect the last payload against invalidation by the I/O component
+	std::lock_guard inputLock { _inputMutex };
+
+	// We can only fill the gap from a payload that was read after the last write. An older payload would not contain the
+	// values written since, and bridging the gap with it would overwrite them with stale data.
+	if (_lastPayload.empty() || _lastPayloadWriteCount != _writeCount.load(std::memory_order_relaxed))
+	{
+		return false;
+	}
+
+	// The gap must lie within the range of a single read command, because the bytes between the ranges of different commands
+	// were never received.
+	const auto gapEnd = offset + gap.size();
+	const auto received = std::ranges::any_of(_readCommands, [&](const std::unique_ptr<ReadCommand> &command) {
+		return offset >= command->offset() && gapEnd <= command->offset() + command->size();
+	});
+	if (!received)
+	{
+		return false;
+	}
+
+	std::ranges::copy(_lastPayload.subspan(offset, gap.size()), gap.begin());
+	return true;
+}
+
+auto TemplateIoTransaction::writeThroughThread(std::stop_token stopToken) -> void
+{
+	// Wake up the thread when it is asked to stop
+	std::stop_callback wakeUp { stopToken, [this]() {
+		_writeThroughRequested.store(true, std::memory_order_release);
+		_writeThroughRequested.notify_one();
+	} };
+
+	while (!stopToken.stop_requested())
+	{
+		// Wait until there is something to write
+		_writeThroughRequested.wait(false, std::memory_order_acquire);
+		// Reset the flag before writing, so that values scheduled during the write wake us up again. This must be an exchange
+		// rather than a store, so that we synchronize with the outputs that were marked before the flag was set.
+		_writeThroughRequested.exchange(false, std::memory_order_acq_rel);
+		if (stopToken.stop_requested())
+		{
+			break;
+		}
+
+		// Only write if the I/O component is connected. Otherwise, the outputs stay pending and are written by the next
+		// write task or the next value that is scheduled.
+		if (!_ioComponent.get().connected())
+		{
+			continue;
+		}
+
+		// Write the pending outputs. We have no scheduled time, so we use the current time.
+		write(std::chrono::system_clock::now());
+	}
 }
 
 auto TemplateIoTransaction::handleWriteError(std::chrono::system_clock::time_point timeStamp, std::error_code error, const OutputList &outputs)
@@ -332,47 +868,173 @@ auto TemplateIoTransaction::handleWriteError(std::chrono::system_clock::time_poi
 	_ioComponent.get().handleError(timeStamp, error, this);
 }
 
-auto TemplateIoTransaction::updateInputs(std::chrono::system_clock::time_point timeStamp, const utils::eh::expected<std::reference_wrapper<const ReadCommand::Payload>, std::error_code> &payloadOrError)
-	-> void
+auto TemplateIoTransaction::reuseLastPayload(std::chrono::system_clock::time_point timeStamp) -> bool
 {
+	// Protect the last payload against invalidation by the I/O component
+	std::lock_guard lock { _inputMutex };
+
+	// Check if the last read was successful, and the read task was executed within the maximum age. We don't reuse payloads
+	// for earlier time stamps, as this would make the update time go backwards.
+	if (_maxAge == std::chrono::system_clock::duration::zero() ||
+		_lastPayload.empty() ||
+		timeStamp < _lastPayloadTime ||
+		timeStamp - _lastPayloadTime >= _maxAge)
+	{
+		return false;
+	}
+
 	// Protect use of the pending event buffer
 	RuntimeBufferSentinel eventsToRaiseSentinel(_runtimeBuffers._eventsToRaise);
 
 	// Make a write sentinel
 	memory::WriteSentinel sentinel { _readDataBlock };
 
+	// Update the update time of the common read state. Nothing else can have changed.
+	_readState.update(sentinel, timeStamp, std::error_code(), _runtimeBuffers._eventsToRaise);
+	// Keep the inputs unchanged
+	_decodePlan.keep(sentinel);
+
+	// Commit the data and raise the events
+	sentinel.commit(timeStamp, _runtimeBuffers._eventsToRaise);
+
+	return true;
+}
+
+auto TemplateIoTransaction::isLastPayload(const ReadCommand::Payload &payload) const noexcept -> bool
+{
+	const auto data = payload.data();
+	return _inputsMatchLastPayload &&
+		!_lastPayload.empty() &&
+		data.size() == _lastPayload.size() &&
+		std::memcmp(data.data(), _lastPayload.data(), data.size()) == 0;
+}
+
+auto TemplateIoTransaction::updateInputs(std::chrono::system_clock::time_point timeStamp,
+	const utils::eh::expected<std::reference_wrapper<const ReadCommand::Payload>, std::error_code> &payloadOrError,
+	bool ownPayload) -> void
+{
+	std::lock_guard lock { _inputMutex };
+	updateInputsLocked(timeStamp, payloadOrError, ownPayload);
+}
+
+auto TemplateIoTransaction::updateInputsLocked(std::chrono::system_clock::time_point timeStamp,
+	const utils::eh::expected<std::reference_wrapper<const ReadCommand::Payload>, std::error_code> &payloadOrError,
+	bool ownPayload) -> void
+{
+	// Protect use of the pending event buffer
+	RuntimeBufferSentinel eventsToRaiseSentinel(_runtimeBuffers._eventsToRaise);
+
+	// Make a write sentinel
+	WriteSentinel sentinel { _readDataBlock };
+
+	// Update the inputs
+	stageInputs(sentinel, timeStamp, payloadOrError, ownPayload, _runtimeBuffers._eventsToRaise);
+
+	// Commit the data and raise the events
+	sentinel.commit(timeStamp, _runtimeBuffers._eventsToRaise);
+}
+
+auto TemplateIoTransaction::stageInputs(WriteSentinel &sentinel, std::chrono::system_clock::time_point timeStamp,
+	const utils::eh::expected<std::reference_wrapper<const ReadCommand::Payload>, std::error_code> &payloadOrError,
+	bool ownPayload, PendingEventList &eventsToRaise) -> void
+{
 	// Update the common read state
-	const auto commonChanges = _readState.update(sentinel, timeStamp, payloadOrError.error(), _runtimeBuffers._eventsToRaise);
+	const auto commonChanges = _readState.update(sentinel, timeStamp, payloadOrError.error(), eventsToRaise);
 
+	// If the payload is byte-for-byte identical to the last one, and the common read state is unchanged, none of the inputs can
+	// have changed, so we don't need to decode anything.
+	if (payloadOrError && !commonChanges && isLastPayload(payloadOrError->get()))
+	{
+		_decodePlan.keep(sentinel);
+	}
 	// Update all the inputs
-	for (auto &&input : _inputs)
+	else
 	{
-		input.get().updateReadState(sentinel, timeStamp, payloadOrError, commonChanges, _runtimeBuffers._eventsToRaise);
+		_decodePlan.update(sentinel, timeStamp, payloadOrError, commonChanges, eventsToRaise);
 	}
 
-	// Commit the data and raise the events
-	sentinel.commit(timeStamp, _runtimeBuffers._eventsToRaise);
+	// Remember the payload for next time, if it is in one of our own buffers
+	_lastPayload = payloadOrError && ownPayload ? payloadOrError->get().data() : std::span<const std::byte> {};
+	_lastPayloadTime = timeStamp;
+	const auto readStartWriteCount = _readStartWriteCount.load(std::memory_order_relaxed);
+	_lastPayloadWriteCount = readStartWriteCount;
+	_inputsMatchLastPayload = !_lastPayload.empty();
+	_inputError = payloadOrError.error();
+
+	// Let the outputs check whether the device still has the values they last wrote. A payload read before the last write
+	// would show the old values, so it is not used.
+	if (payloadOrError && readStartWriteCount == _writeCount.load(std::memory_order_acquire))
+	{
+		for (auto &&output : _outputs)
+		{
+			output.get().checkReadBack(payloadOrError->get());
+		}
+	}
 }
 
 auto TemplateIoTransaction::updateOutputs(std::chrono::system_clock::time_point timeStamp, std::error_code error, const OutputList &outputs) -> void
 {
+	// Protect use of the pending event buffer
+	RuntimeBufferSentinel eventsToRaiseSentinel(_runtimeBuffers._writeEventsToRaise);
+
+	// Make a write sentinel. The write states live in their own data block, so that writes never contend with reads.
+	memory::WriteSentinel sentinel { _writeDataBlock };
+
+	// Update the latest state
+	_writeState.update(sentinel, timeStamp, error, _runtimeBuffers._writeEventsToRaise);
+
+	// Carry over the states of all the outputs first, because memory resources use swap-in. This is a simple copy of each state
+	// that doesn't go through the outputs, so it stays cheap even if only a few of many outputs were written.
+	for (auto &&writeState : _outputWriteStates)
+	{
+		writeState.get().keep(sentinel);
+	}
+	// Update the outputs that were actually written
+	for (auto &&output : outputs)
+	{
+		output.get().updateWriteState(sentinel, timeStamp, error, _runtimeBuffers._writeEventsToRaise);
+	}
+
+	// Commit the data and raise the events
+	sentinel.commit(timeStamp, _runtimeBuffers._writeEventsToRaise);
+}
+
+auto TemplateIoTransaction::updateReadBack(std::chrono::system_clock::time_point timeStamp, const OutputList &outputs) -> void
+{
+	// Don't wait for a read in progress, as this would delay the write by an entire round trip. The read will update
+	// the read-back values soon enough.
+	std::unique_lock lock { _readMutex, std::try_to_lock };
+	if (!lock.owns_lock())
+	{
+		return;
+	}
+	// Protect the read data block against invalidation by the I/O component
+	std::lock_guard inputLock { _inputMutex };
+
 	// Protect use of the pending event buffer
 	RuntimeBufferSentinel eventsToRaiseSentinel(_runtimeBuffers._eventsToRaise);
 
 	// Make a write sentinel
 	memory::WriteSentinel sentinel { _readDataBlock };
 
-	// Update the latest state
-	_writeState.update(sentinel, timeStamp, error, _runtimeBuffers._eventsToRaise);
-
-	// Update all the relevant outputs
+	// Keep everything unchanged first, because memory resources use swap-in. The update time of the common read state is
+	// not changed, because nothing was actually read.
+	_readState.keep(sentinel);
+	_decodePlan.keep(sentinel);
+	// Update the read-back values of the outputs that were written
 	for (auto &&output : outputs)
 	{
-		output.get().updateWriteState(sentinel, timeStamp, error, _runtimeBuffers._eventsToRaise);
+		if (output.get().readsBackWrites())
+		{
+			output.get().updateReadBack(sentinel, timeStamp, _runtimeBuffers._eventsToRaise);
+		}
 	}
 
+	// The inputs no longer reflect the last payload
+	_inputsMatchLastPayload = false;
+
 	// Commit the data and raise the events
 	sentinel.commit(timeStamp, _runtimeBuffers._eventsToRaise);
 }
 
-} // namespace xentara::plugins::templateDriver
\ No newline at end of file
+} // namespace xentara::plugins::templateDriver
@@ -6,9 +6,15 @@
 #include "CommonReadState.hpp"
 #include "WriteState.hpp"
 #include "CustomError.hpp"
+#include "DecodePlan.hpp"
+#include "DirtyBitmap.hpp"
 #include "Types.hpp"
 #include "ReadCommand.hpp"
+#include "ReceiveBufferPool.hpp"
 #include "ReadTask.hpp"
+#include "ReleaseTask.hpp"
+#include "WriteCommand.hpp"
+#include "WriteGroup.hpp"
 #include "WriteTask.hpp"
 
 #include <xentara/memory/Array.hpp>
@@ -19,9 +25,15 @@
 #include <xentara/utils/core/Uuid.hpp>
 #include <xentara/utils/eh/expected.hpp>
 
+#include <atomic>
+#include <cstddef>
 #include <string_view>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <span>
+#include <stop_token>
+#include <thread>
 #include <vector>
 
 namespace xentara::plugins::templateDriver
@@ -34,7 +46,11 @@ class AbstractOutput;
 
 /// @brief A class representing a specific type of I/O transaction.
 /// @todo rename this class to something more descriptive
-class TemplateIoTransaction final : public skill::Element, public TemplateIoComponent::ErrorSink, public skill::EnableSharedFromThis<TemplateIoTransaction>
+class TemplateIoTransaction final :
+	public skill::Element,
+	public TemplateIoComponent::ErrorSink,
+	public ReadCoalescer::Client,
+	public skill::EnableSharedFromThis<TemplateIoTransaction>
 {
 public:
 	/// @brief The class object containing meta-information about this element type
@@ -82,7 +98,31 @@ public:
 	}
 	
 	/// @brief This function adds an output to be processed by the transaction
-	auto addOutput(std::reference_wrapper<AbstractOutput> output) -> void;
+	/// @return The index of the output, which must be passed to markOutputPending() when a value is scheduled for the output.
+	auto addOutput(std::reference_wrapper<AbstractOutput> output) -> std::size_t;
+
+	/// @brief Checks whether values that could not be written are retried
+	auto writeRetriesEnabled() const noexcept -> bool
+	{
+		return _writeRetryDelay != std::chrono::system_clock::duration::zero();
+	}
+
+	/// @brief Marks an output as having a value that could not be written, so that it will be retried after a delay.
+	/// @param outputIndex The index returned by addOutput()
+	auto markOutputForRetry(std::size_t outputIndex) noexcept -> void
+	{
+		_retryOutputs.mark(outputIndex);
+	}
+
+	/// @brief Marks an output as having pending values, so that the next write will add them to the write command.
+	///
+	/// This function can be called from any thread.
+	/// @param outputIndex The index returned by addOutput()
+	auto markOutputPending(std::size_t outputIndex) noexcept -> void
+	{
+		_pendingOutputs.mark(outputIndex);
+		requestWriteThrough();
+	}
 
 	/// @brief Gets the data block that holds the data for the write operations
 	constexpr auto writeDataBlock() noexcept -> DataBlock &
@@ -116,7 +156,36 @@ public:
 	/// @name Virtual Overrides for TemplateIoComponent::ErrorSink
 	/// @{
 
-	auto ioComponentStateChanged(std::chrono::system_clock::time_point timeStamp, std::error_code error) -> void final;
+	auto ioComponentStateChanged(std::chrono::system_clock::time_point timeStamp, std::error_code error,
+		PendingEventList &eventsToRaise) -> void final;
+
+	auto stateChangeEventCount() const noexcept -> std::size_t final
+	{
+		return _readEventCount;
+	}
+
+	/// @}
+
+	/// @name Virtual Overrides for ReadCoalescer::Client
+	/// @{
+
+	auto coalescedBaseAddress() const noexcept -> std::size_t final
+	{
+		return _baseAddress;
+	}
+
+	auto coalescedPayloadSize() const noexcept -> std::size_t final
+	{
+		return _decodePlan.payloadSize();
+	}
+
+	auto coalescedReadCommands() const noexcept -> std::span<const std::unique_ptr<ReadCommand>> final
+	{
+		return _readCommands;
+	}
+
+	auto coalescedReadCompleted(std::chrono::system_clock::time_point timeStamp,
+		const utils::eh::expected<std::reference_wrapper<const ReadCommand::Payload>, std::error_code> &payloadOrError) -> void final;
 
 	/// @}
 
@@ -124,6 +193,7 @@ private:
 	// The tasks need access to out private member functions
 	friend class ReadTask<TemplateIoTransaction>;
 	friend class WriteTask<TemplateIoTransaction>;
+	friend class ReleaseTask<TemplateIoTransaction>;
 
 	/// @brief This function is forwarded to the I/O component.
 	auto requestConnect(std::chrono::system_clock::time_point timeStamp) noexcept -> void
@@ -143,6 +213,35 @@ private:
 	auto performReadTask(const process::ExecutionContext &context) -> void;
 	/// @brief Attempts to read the data from the I/O component and updates the state accordingly.
 	auto read(std::chrono::system_clock::time_point timeStamp) -> void;
+	/// @brief Submits the read commands to the I/O component without waiting for the responses.
+	///
+	/// This function is used instead of read() if asynchronous reads are enabled. The responses are processed by
+	/// readCompleted(), which is called by the I/O component once each response has arrived. If the previous read
+	/// commands are still outstanding, no new commands are submitted.
+	auto submitRead(std::chrono::system_clock::time_point timeStamp) -> void;
+	/// @brief Processes the response of a read command submitted using submitRead().
+	///
+	/// This function is called from whatever thread the I/O component uses to deliver responses. The inputs are updated
+	/// once the responses to all the read commands have arrived.
+	/// @param readId The value of _pendingReadId when the command was submitted. Responses to abandoned commands are ignored.
+	/// @param commandIndex The index of the command within _readCommands
+	/// @param responseSizeOrError This is a variant-like type that will hold either the number of bytes received into the
+	/// response buffer of the command, or an std::error_code object containing a read error.
+	auto readCompleted(std::size_t readId,
+		std::size_t commandIndex,
+		const utils::eh::expected<std::size_t, std::error_code> &responseSizeOrError) -> void;
+	/// @brief Records the outcome of one or more asynchronous read commands, and updates the inputs if they were the last ones outstanding.
+	/// @param readId The value of _pendingReadId when the commands were submitted
+	/// @param commandIndex The index of the first command within _readCommands
+	/// @param commandCount The number of commands, starting at *commandIndex*
+	/// @param error The error code, or a default constructed std::error_code object if the commands succeeded
+	auto finishReadCommands(std::size_t readId, std::size_t commandIndex, std::size_t commandCount, std::error_code error) -> void;
+	/// @brief Checks whether asynchronous read commands are still outstanding and have not been abandoned
+	auto isPendingRead(std::size_t readId) noexcept -> bool;
+	/// @brief Abandons any outstanding asynchronous read commands, so that new ones can be submitted
+	///
+	/// Responses that arrive for the abandoned commands later on are ignored.
+	auto abandonPendingRead() noexcept -> void;
 	/// @brief Handles a read error
 	auto handleReadError(std::chrono::system_clock::time_point timeStamp, std::error_code error) -> void;
 
@@ -152,6 +251,33 @@ private:
 	auto performWriteTask(const process::ExecutionContext &context) -> void;
 	/// @brief Attempts to write any pending value to the I/O component and updates the state accordingly.
 	auto write(std::chrono::system_clock::time_point timeStamp) -> void;	
+	/// @brief Determines when values that could not be written may be retried, after a write failed. Does nothing if retries are disabled.
+	auto scheduleWriteRetry(std::chrono::system_clock::time_point timeStamp) -> void;
+	/// @brief Fills a gap between two output values in a write command with the current contents of the device
+	/// @param offset The offset of the gap, relative to the base address of the transaction
+	/// @param gap The bytes to fill
+	/// @return Returns *true* if the gap lies within the range of a single read command of the last successful read, that read
+	/// was started after the last write, and the gap was filled. Returns *false* if the current contents are not known.
+	auto fillWriteGap(std::size_t offset, std::span<std::byte> gap) -> bool;
+	/// @brief Wakes up the write-through thread, if write-through is enabled.
+	///
+	/// The thread is not woken up again if it has already been woken up and not gotten around to writing yet.
+	/// This coalesces values scheduled in quick succession into a single write.
+	auto requestWriteThrough() noexcept -> void
+	{
+		if (_writeThrough && !_writeThroughRequested.exchange(true, std::memory_order_acq_rel))
+		{
+			_writeThroughRequested.notify_one();
+		}
+	}
+	/// @brief This function is called by the "release" task.
+	///
+	/// This function releases the values staged in the write group, so that they are written together.
+	auto performReleaseTask(const process::ExecutionContext &context) -> void;
+	/// @brief The function executed by the write-through thread.
+	///
+	/// The thread sleeps until an output is marked as pending, and then writes all pending outputs immediately.
+	auto writeThroughThread(std::stop_token stopToken) -> void;
 	/// @brief Handles a write error
 	auto handleWriteError(std::chrono::system_clock::time_point timeStamp, std::error_code error, const OutputList &outputs) -> void;
 
@@ -159,8 +285,31 @@ private:
 	/// @param timeStamp The update time stamp
 	/// @param payloadOrError This is a variant-like type that will hold either the payload of the read command, or an std::error_code object
 	/// containing a read error.
+	/// @param ownPayload Whether the payload is in one of the transaction's own receive buffers. Only such payloads are remembered
+	/// for comparison with the next one, because a payload in a buffer belonging to someone else may be overwritten at any time.
 	auto updateInputs(std::chrono::system_clock::time_point timeStamp,
-		const utils::eh::expected<std::reference_wrapper<const ReadCommand::Payload>, std::error_code> &payloadOrError) -> void;
+		const utils::eh::expected<std::reference_wrapper<const ReadCommand::Payload>, std::error_code> &payloadOrError,
+		bool ownPayload) -> void;
+	/// @brief Updates the inputs like updateInputs(), for callers that already hold _inputMutex
+	/// @note This function must be called with _inputMutex held.
+	auto updateInputsLocked(std::chrono::system_clock::time_point timeStamp,
+		const utils::eh::expected<std::reference_wrapper<const ReadCommand::Payload>, std::error_code> &payloadOrError,
+		bool ownPayload) -> void;
+	/// @brief Writes the updated inputs to a write sentinel for the read data block, without committing it
+	/// @param sentinel The write sentinel to update
+	/// @param eventsToRaise Any events that need to be raised will be added to this list. The caller must raise them after
+	/// committing the sentinel.
+	/// @note This function must be called with _inputMutex held.
+	auto stageInputs(WriteSentinel &sentinel, std::chrono::system_clock::time_point timeStamp,
+		const utils::eh::expected<std::reference_wrapper<const ReadCommand::Payload>, std::error_code> &payloadOrError,
+		bool ownPayload, PendingEventList &eventsToRaise) -> void;
+	/// @brief Re-commits the inputs with a new update time if the last payload is recent enough, instead of reading them again.
+	/// @param timeStamp The update time stamp
+	/// @return Returns *true* if the last payload was reused, or *false* if the data must be read from the device.
+	/// @note This function must be called with _readMutex held.
+	auto reuseLastPayload(std::chrono::system_clock::time_point timeStamp) -> bool;
+	/// @brief Checks whether a payload is identical to the payload of the last successful read
+	auto isLastPayload(const ReadCommand::Payload &payload) const noexcept -> bool;
 
 	/// @brief Updates the outputs and sends events
 	/// @param timeStamp The update time stamp
@@ -168,6 +317,10 @@ private:
 	/// @param outputs The outputs to update
 	auto updateOutputs(
 		std::chrono::system_clock::time_point timeStamp, std::error_code error, const OutputList &outputs) -> void;
+	/// @brief Sets the read-back values of outputs that were written successfully to the written values
+	/// @param timeStamp The time stamp of the write
+	/// @param outputs The outputs that were written
+	auto updateReadBack(std::chrono::system_clock::time_point timeStamp, const OutputList &outputs) -> void;
 
 	/// @brief The I/O component this transaction belongs to
 	/// @todo give this a more descriptive name, e.g. "_device"
@@ -196,18 +349,138 @@ private:
 	std::vector<std::reference_wrapper<AbstractInput>> _inputs;
 	/// @brief The list of outputs
 	std::vector<std::reference_wrapper<AbstractOutput>> _outputs;
+	/// @brief The outputs that have pending values, by index
+	DirtyBitmap _pendingOutputs;
+	/// @brief The outputs that have values to retry, by index
+	DirtyBitmap _retryOutputs;
+	/// @brief The values of staged outputs that are released together
+	WriteGroup _writeGroup;
+	/// @brief The write states of all the outputs
+	///
+	/// These are collected when the outputs are attached, so that the states of outputs that were not written can be carried
+	/// over without going through the outputs themselves.
+	std::vector<std::reference_wrapper<const WriteState>> _outputWriteStates;
+	/// @brief Whether any of the outputs reflect successfully written values in their read-back values right away
+	bool _readBackWrites { false };
 
-	/// @brief The read command to send, or nullptr if it hasn't been constructed yet.
-	std::unique_ptr<ReadCommand> _readCommand;
+	/// @brief The plan used to decode the values of all the inputs from the payload of the read command
+	DecodePlan _decodePlan;
+	/// @brief The layout of the input values within the read data block
+	ValueLayout _valueLayout { ValueLayout::Interleaved };
 
-	/// @class xentara::plugins::templateDriver::TemplateIoTransaction
-	/// @note There is no member for the write command, as the write command is constructed on-the-fly,
-	/// depending on which outputs wave to be written.
+	/// @brief The connection of the I/O component assigned to the transaction
+	std::size_t _assignedConnection { 0 };
+
+	/// @brief The read commands to send.
+	///
+	/// There is one command for each part of the payload, as partitioned according to the maximum PDU size of the I/O component.
+	std::vector<std::unique_ptr<ReadCommand>> _readCommands;
+
+	/// @brief Whether the reads are coalesced with those of other transactions by the I/O component
+	bool _coalesceReads { false };
+	/// @brief The device address of the first byte of the payload. This is used to merge the reads of different transactions.
+	/// @todo use the correct type for device addresses
+	std::size_t _baseAddress { 0 };
+
+	/// @brief Whether the read command is submitted asynchronously instead of waiting for the response
+	bool _asyncRead { false };
+	/// @brief The maximum time to wait for the responses to asynchronous read commands before they are abandoned as timed out
+	/// @todo use the correct default for the protocol
+	std::chrono::system_clock::duration _readTimeout { std::chrono::seconds(10) };
+	/// @brief A mutex protecting the bookkeeping of the outstanding asynchronous read commands.
+	///
+	/// This is only held briefly, and never while communicating with the device or calling into the I/O component, so that the
+	/// commands can be abandoned when the connection is lost.
+	std::mutex _pendingReadMutex;
+	/// @brief Whether asynchronous read commands are currently outstanding
+	bool _readPending { false };
+	/// @brief Identifies the outstanding asynchronous read commands.
+	///
+	/// This changes whenever new commands are submitted or the outstanding ones are abandoned, so that late responses to
+	/// abandoned commands can be recognized and ignored.
+	std::size_t _pendingReadId { 0 };
+	/// @brief The number of asynchronous read commands whose responses have not yet been processed
+	std::size_t _pendingCommandCount { 0 };
+	/// @brief The outcome of each outstanding asynchronous read command.
+	///
+	/// There is one entry per read command, so that responses arriving on different threads never write to the same entry.
+	std::vector<std::error_code> _pendingCommandErrors;
+	/// @brief The time stamp of the outstanding asynchronous read command
+	std::chrono::system_clock::time_point _pendingReadTime;
+	/// @brief The buffer the responses to the outstanding asynchronous read commands are received into
+	std::span<std::byte> _pendingReceiveBuffer;
+
+	/// @brief The maximum number of bytes between two outputs that may be written along with them to merge them into a single write
+	std::size_t _writeGapTolerance { 0 };
+
+	/// @brief The delay before retrying values that could not be written, or 0 to not retry them.
+	///
+	/// The delay doubles with every consecutive failed write, up to _maxWriteRetryDelay.
+	std::chrono::system_clock::duration _writeRetryDelay { 0 };
+	/// @brief The maximum delay before retrying values that could not be written
+	std::chrono::system_clock::duration _maxWriteRetryDelay { std::chrono::minutes(1) };
+	/// @brief The number of consecutive failed writes
+	std::size_t _failedWriteCount { 0 };
+	/// @brief The earliest time values that could not be written may be retried
+	std::chrono::system_clock::time_point _nextWriteRetryTime;
+
+	/// @brief Whether pending outputs are written immediately by a dedicated thread, rather than by the write task
+	bool _writeThrough { false };
+	/// @brief Set when the write-through thread should write the pending outputs
+	std::atomic<bool> _writeThroughRequested { false };
+	/// @brief A mutex that serializes writes by the write task and the write-through thread
+	std::mutex _writeMutex;
+	/// @brief The number of writes that have been sent. This is used to tell whether a payload was read after a write.
+	std::atomic<std::size_t> _writeCount { 0 };
+
+	/// @brief The preallocated buffers the responses to the read command are received into
+	ReceiveBufferPool _receiveBuffers;
+
+	/// @brief The payload of the last successful read, or an empty span if the last read failed.
+	///
+	/// This refers to one of the buffers in _receiveBuffers. The pool contains two buffers, so that the last payload is still
+	/// intact when the next response is received.
+	std::span<const std::byte> _lastPayload;
+	/// @brief The time stamp of the read that received the last payload
+	std::chrono::system_clock::time_point _lastPayloadTime;
+	/// @brief The number of writes that had been sent when the read that received the last payload was started.
+	///
+	/// If more writes have been sent since, the last payload may not reflect them, and must not be used to fill write gaps.
+	std::size_t _lastPayloadWriteCount { 0 };
+	/// @brief The number of writes that had been sent when the current read was started
+	///
+	/// This is atomic, because it is set without holding _inputMutex, but read while updating the inputs.
+	std::atomic<std::size_t> _readStartWriteCount { 0 };
+	/// @brief The error the inputs were last updated with, or a default constructed std::error_code object if the last read succeeded.
+	///
+	/// This starts out as CustomError::NotConnected, to match the initial state of the read data block. It is protected by _inputMutex,
+	/// because the I/O component checks it on its own threads when invalidating the inputs.
+	std::error_code _inputError { CustomError::NotConnected };
+	/// @brief Whether the values of the inputs were all decoded from the last payload.
+	///
+	/// This is reset when the read-back values of outputs are set to written values, so that the next payload is decoded
+	/// even if the device still reports the same data.
+	bool _inputsMatchLastPayload { false };
+
+	/// @brief How long a payload may be reused if the read task is executed again, or 0 to always read from the device.
+	std::chrono::system_clock::duration _maxAge { 0 };
+	/// @brief A mutex that serializes reads triggered from different threads, e.g. by different pipelines.
+	///
+	/// A synchronous read holds the mutex for the entire round trip, so that other pipelines triggering the read task at the same time
+	/// wait for the result, and can then reuse it if a maximum age is configured.
+	std::mutex _readMutex;
+	/// @brief A mutex that protects the read data block, and the information about the last payload and the input error.
+	///
+	/// Unlike _readMutex, this is only held while the inputs are being updated, and never while communicating with the device or
+	/// calling into the I/O component, so that the I/O component can invalidate the inputs while a read is in progress.
+	std::mutex _inputMutex;
 
 	/// @brief The array that describes the structure of the read data block
 	memory::Array _readDataArray;
 	/// @brief The data block that holds the data for the inputs
 	DataBlock _readDataBlock { _readDataArray };
+	/// @brief The maximum number of events a single update of the inputs can raise
+	std::size_t _readEventCount { 0 };
 
 	/// @brief The array that describes the structure of the write data block
 	memory::Array _writeDataArray;
@@ -223,6 +496,8 @@ private:
 	ReadTask<TemplateIoTransaction> _readTask { *this };
 	/// @brief The "write" task
 	WriteTask<TemplateIoTransaction> _writeTask { *this };
+	/// @brief The "release" task
+	ReleaseTask<TemplateIoTransaction> _releaseTask { *this };
 
 	/// @brief Preallocated runtime buffers
 	///
@@ -231,13 +506,24 @@ private:
 	/// which would not be real-time safe.
 	struct
 	{
-		/// @brief The list of events to raise after a read or write
+		/// @brief The list of events to raise after a read
 		PendingEventList _eventsToRaise;
+		/// @brief The list of events to raise after a write.
+		///
+		/// This is separate from the list used for reads, so that reads and writes can run on different threads.
+		PendingEventList _writeEventsToRaise;
 
 		/// @brief The outputs to notify after a write operation
 		OutputList _outputsToNotify;
+
+		/// @brief The write command. This is reused for every write, so that its buffers only need to be allocated once.
+		WriteCommand _writeCommand;
 	} _runtimeBuffers;
 
+	/// @brief The write-through thread, if write-through is enabled.
+	/// @note This must be the last data member, so that the thread is stopped before any of the data it uses is destroyed.
+	std::jthread _writeThroughThread;
+
 	/// @class xentara::plugins::templateDriver::TemplateIoTransaction::RuntimeBufferSentinel
 	/// @brief A sentinel that performs initialization and cleanup of a runtime buffer
 	template <typename Buffer>
@@ -2,7 +2,10 @@
 #include "TemplateOutput.hpp"
 
 #include "Attributes.hpp"
+#include "DecodePlan.hpp"
+#include "DecodeTable.hpp"
 #include "TemplateIoTransaction.hpp"
+#include "WriteCommand.hpp"
 
 #include <xentara/config/Context.hpp>
 #include <xentara/config/Errors.hpp>
@@ -16,17 +19,27 @@
 #include <xentara/utils/json/decoder/Object.hpp>
 #include <xentara/utils/json/decoder/Errors.hpp>
 
+#include <atomic>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
 namespace xentara::plugins::templateDriver
 {
 	
 using namespace std::literals;
 
-const model::Attribute TemplateOutput::kValueAttribute { model::Attribute::kValue, model::Attribute::Access::ReadWrite, data::DataType::kFloatingPoint };
+const model::Attribute TemplateOutput::kBooleanValueAttribute { model::Attribute::kValue, model::Attribute::Access::ReadWrite, data::DataType::kBoolean };
+const model::Attribute TemplateOutput::kIntegerValueAttribute { model::Attribute::kValue, model::Attribute::Access::ReadWrite, data::DataType::kInteger };
+const model::Attribute TemplateOutput::kFloatingPointValueAttribute { model::Attribute::kValue, model::Attribute::Access::ReadWrite, data::DataType::kFloatingPoint };
 
 auto TemplateOutput::load(utils::json::decoder::Object &jsonObject, config::Context &context) -> void
 {
 	// Go through all the members of the JSON object that represents this object
 	bool ioTransactionLoaded = false;
+	std::optional<WireType> wireType;
 	for (auto && [name, value] : jsonObject)
     {
 		/// @todo use a more descriptive keyword, e.g. "poll"
@@ -36,10 +49,51 @@ auto TemplateOutput::load(utils::json::decoder::Object &jsonObject, config::Cont
 				{ 
 					_ioTransaction = &ioTransaction.get();
 					ioTransaction.get().addInput(*this);
-					ioTransaction.get().addOutput(*this);
+					_outputIndex = ioTransaction.get().addOutput(*this);
 				});
 			ioTransactionLoaded = true;
 		}
+		else if (name == "dataType"sv)
+		{
+			const auto valueType = parseValueType(value.asString<std::string>());
+			if (!valueType)
+			{
+				utils::json::decoder::throwWithLocation(value, std::runtime_error("unknown data type in template output"));
+			}
+			_valueType = *valueType;
+		}
+		else if (name == "offset"sv)
+		{
+			_dataOffset = value.asNumber<std::size_t>();
+		}
+		else if (name == "wireType"sv)
+		{
+			wireType = parseWireType(value.asString<std::string>());
+			if (!wireType)
+			{
+				utils::json::decoder::throwWithLocation(value, std::runtime_error("unknown wire type in template output"));
+			}
+		}
+		else if (name == "staged"sv)
+		{
+			_staged = value.asBool();
+		}
+		else if (name == "optimisticReadBack"sv)
+		{
+			_readBackWrites = value.asBool();
+		}
+		else if (name == "skipUnchanged"sv)
+		{
+			_skipUnchanged = value.asBool();
+		}
+		else if (name == "queueSize"sv)
+		{
+			_queueSize = value.asNumber<std::size_t>();
+			if (_queueSize == 0)
+			{
+				utils::json::decoder::throwWithLocation(value, std::runtime_error("invalid queue size in template output"));
+			}
+		}
 		/// @todo load custom configuration parameters
 		else if (name == "TODO"sv)
 		{
@@ -67,6 +121,25 @@ auto TemplateOutput::load(utils::json::decoder::Object &jsonObject, config::Cont
 		/// @todo replace "I/O transaction" and "template output" with more descriptive names
 		utils::json::decoder::throwWithLocation(jsonObject, std::runtime_error("missing I/O transaction in template output"));
 	}
+
+	// Staged values are never queued
+	if (_staged && _queueSize > 0)
+	{
+		utils::json::decoder::throwWithLocation(jsonObject, std::runtime_error("queue size specified for staged template output"));
+	}
+
+	// Use the native encoding of the value type if no wire type was specified
+	_wireType = wireType.value_or(nativeWireType(_valueType));
+	// Create the read state, the queue, and the written value for the correct type
+	visitValueType(_valueType, [this]<typename DataType>(std::type_identity<DataType>) {
+		_readState.emplace<PerValueReadState<DataType>>();
+		_pendingOutputValue.emplace<OutputQueue<DataType>>(_queueSize);
+		// Preallocate room for a whole batch of values, so that writing and retrying never allocates
+		auto &writtenValue = _writtenValue.emplace<WrittenValue<DataType>>();
+		const auto batchSize = std::get<OutputQueue<DataType>>(_pendingOutputValue).batchSize();
+		writtenValue._sentValues.reserve(batchSize);
+		writtenValue._retryValues.reserve(batchSize);
+	});
 	/// @todo perform consistency and completeness checks
 	if (!"TODO")
 	{
@@ -75,9 +148,23 @@ auto TemplateOutput::load(utils::json::decoder::Object &jsonObject, config::Cont
 	}
 }
 
+auto TemplateOutput::valueAttribute() const noexcept -> const model::Attribute &
+{
+	switch (_valueType)
+	{
+	case ValueType::Boolean:
+		return kBooleanValueAttribute;
+	case ValueType::Float:
+	case ValueType::Double:
+		return kFloatingPointValueAttribute;
+	default:
+		return kIntegerValueAttribute;
+	}
+}
+
 auto TemplateOutput::dataType() const -> const data::DataType &
 {
-	return kValueAttribute.dataType();
+	return valueAttribute().dataType();
 }
 
 auto TemplateOutput::directions() const -> io::Directions
@@ -96,10 +183,10 @@ auto TemplateOutput::forEachAttribute(const model::ForEachAttributeFunction &fun
 
 	return
 		// Handle all the attributes we support directly
-		function(kValueAttribute) ||
+		function(valueAttribute()) ||
 
 		// Handle the read state attributes
-		_readState.forEachAttribute(function) ||
+		std::visit([&](const auto &state) { return state.forEachAttribute(function); }, _readState) ||
 		// Also handle the common read state attributes from the I/O transaction
 		_ioTransaction->forEachReadStateAttribute(function) ||
 
@@ -120,7 +207,7 @@ auto TemplateOutput::forEachEvent(const model::ForEachEventFunction &function) -
 
 	return
 		// Handle the read state events
-		_readState.forEachEvent(function, sharedFromThis()) ||
+		std::visit([&](auto &state) { return state.forEachEvent(function, sharedFromThis()); }, _readState) ||
 		// Also handle the common read state events from the I/O transaction
 		_ioTransaction->forEachReadStateEvent(function) ||
 
@@ -144,13 +231,13 @@ auto TemplateOutput::makeReadHandle(const model::Attribute &attribute) const noe
 	const auto &writeDataBlock = _ioTransaction->writeDataBlock();
 	
 	// Handle the value attribute separately
-	if (attribute == kValueAttribute)
+	if (attribute == valueAttribute())
 	{
-		return _readState.valueReadHandle(readDataBlock);
+		return std::visit([&](const auto &state) { return state.valueReadHandle(readDataBlock); }, _readState);
 	}
 	
 	// Handle the read state attributes
-	if (auto handle = _readState.makeReadHandle(readDataBlock, attribute))
+	if (auto handle = std::visit([&](const auto &state) { return state.makeReadHandle(readDataBlock, attribute); }, _readState))
 	{
 		return handle;
 	}
@@ -174,11 +261,12 @@ auto TemplateOutput::makeReadHandle(const model::Attribute &attribute) const noe
 auto TemplateOutput::makeWriteHandle(const model::Attribute &attribute) noexcept -> std::optional<data::WriteHandle>
 {
 	// Handle the value attribute
-	if (attribute == kValueAttribute)
+	if (attribute == valueAttribute())
 	{
-		// This magic code creates a write handle of type double that calls scheduleWrite() on this.
-		/// @todo use the correct value type
-		return data::WriteHandle { std::in_place_type<double>, &TemplateOutput::scheduleOutputValue, weakFromThis() };
+		// This magic code creates a write handle of the correct type that calls scheduleOutputValue() on this.
+		return visitValueType(_valueType, [this]<typename DataType>(std::type_identity<DataType>) {
+			return data::WriteHandle { std::in_place_type<DataType>, &TemplateOutput::scheduleOutputValue<DataType>, weakFromThis() };
+		});
 	}
 
 	/// @todo handle any additional writable attributes this class supports, including attributes inherited from the I/O component and the I/O transaction
@@ -186,47 +274,130 @@ auto TemplateOutput::makeWriteHandle(const model::Attribute &attribute) noexcept
 	return std::nullopt;
 }
 
-auto TemplateOutput::attachInput(memory::Array &dataArray, std::size_t &eventCount) -> void
+auto TemplateOutput::addToDecodePlan(DecodePlan &decodePlan) -> void
 {
-	_readState.attach(dataArray, eventCount);
+	std::visit([&](auto &state) { decodePlan.add(_dataOffset, _wireType, state); }, _readState);
 }
 
-auto TemplateOutput::updateReadState(WriteSentinel &writeSentinel,
-	std::chrono::system_clock::time_point timeStamp,
-	const utils::eh::expected<std::reference_wrapper<const ReadCommand::Payload>, std::error_code> &payloadOrError,
-	const CommonReadState::Changes &commonChanges,
-	PendingEventList &eventsToRaise) -> void
+auto TemplateOutput::attachWriteGroup(WriteGroup &writeGroup) -> void
 {
-	// Check if we have a valid payload
-	if (payloadOrError)
+	if (!_staged)
 	{
-		/// @todo decode the value from the payload data
-		double value = {};
-
-		// Update the read state
-		_readState.update(writeSentinel, timeStamp, value, commonChanges, eventsToRaise);
-	}
-	// We have an error
-	else
-	{
-		// Update the read state with the error
-		_readState.update(writeSentinel, timeStamp, utils::eh::unexpected(payloadOrError.error()), commonChanges, eventsToRaise);
+		return;
 	}
+
+	const auto valueSize = visitValueType(_valueType, []<typename DataType>(std::type_identity<DataType>) { return sizeof(DataType); });
+	_writeGroupSlot = writeGroup.addSlot(_outputIndex, valueSize);
+	_writeGroup = &writeGroup;
+}
+
+auto TemplateOutput::addWriteCapacity(std::size_t &valueCount, std::size_t &dataSize) const -> void
+{
+	const auto batchSize = std::visit([](const auto &queue) { return queue.batchSize(); }, _pendingOutputValue);
+	valueCount += batchSize;
+	dataSize += batchSize * wireSize(_wireType);
 }
 
 auto TemplateOutput::addToWriteCommand(WriteCommand &command) -> bool
 {
-	// Get the value
-	auto pendingValue = _pendingOutputValue.dequeue();
-	// If there was no pending value, do nothing
-	if (!pendingValue)
-	{
-		return false;
-	}
+	return std::visit(
+		[&]<typename DataType>(OutputQueue<DataType> &queue) {
+			auto &writtenValue = std::get<WrittenValue<DataType>>(_writtenValue);
+			writtenValue._sent.reset();
+			writtenValue._sentValues.clear();
+
+			// Forget the confirmed value if the device may no longer have it
+			if (_writtenValueStale.exchange(false, std::memory_order_acquire))
+			{
+				writtenValue.confirm(std::nullopt);
+			}
 
-	/// @todo add the value to the command
+			// Adds a single value to the command
+			const auto addValue = [&](const DataType &pendingValue) {
+				// Skip the value if the device will already have it, either because it was written before, or because the
+				// same value was already added to this command.
+				if (_skipUnchanged)
+				{
+					const auto &deviceValue = writtenValue._sent ? writtenValue._sent : writtenValue._confirmed;
+					if (deviceValue == pendingValue)
+					{
+						return;
+					}
+				}
+
+				// Outputs are written to the same address they are read back from
+				command.add(_dataOffset, _wireType, pendingValue);
+				writtenValue._sent = pendingValue;
+				writtenValue._sentValues.push_back(pendingValue);
+			};
+
+			// Adds the values that could not be written before to the command again
+			const auto addRetryValues = [&]() {
+				// The values are copied, because std::vector<bool> only hands out proxies
+				for (const DataType retryValue : writtenValue._retryValues)
+				{
+					command.add(_dataOffset, _wireType, retryValue);
+					writtenValue._sent = retryValue;
+					writtenValue._sentValues.push_back(retryValue);
+				}
+				writtenValue._retryValues.clear();
+			};
+
+			// Queued outputs must deliver every value in order, so a batch that could not be written is sent again before any new
+			// values. The new values stay queued until the next write, because the command only has room for a single batch.
+			if (_queueSize > 0 && !writtenValue._retryValues.empty())
+			{
+				addRetryValues();
+				markPending();
+				return true;
+			}
 
-	return true;
+			std::size_t valueCount = 0;
+			// Staged outputs take their value from the write group
+			if (_writeGroup)
+			{
+				DataType stagedValue {};
+				if (_writeGroup->take(_writeGroupSlot, std::as_writable_bytes(std::span(&stagedValue, 1))))
+				{
+					addValue(stagedValue);
+					++valueCount;
+				}
+			}
+			// Other outputs add all pending values in the order they were scheduled. If there were no pending values, this does nothing.
+			else
+			{
+				bool morePending = false;
+				valueCount = queue.dequeueBatch(addValue, morePending);
+
+				// If the batch was cut short, make sure we get called again on the next write
+				if (morePending)
+				{
+					markPending();
+				}
+			}
+
+			// For outputs that only keep the last value, new values supersede a value that could not be written. If there are none,
+			// we retry the failed value.
+			if (valueCount > 0)
+			{
+				writtenValue._retryValues.clear();
+			}
+			else
+			{
+				addRetryValues();
+			}
+
+			return writtenValue._sent.has_value();
+		},
+		_pendingOutputValue);
+}
+
+auto TemplateOutput::markPending() noexcept -> void
+{
+	if (_ioTransaction) [[likely]]
+	{
+		_ioTransaction->markOutputPending(_outputIndex);
+	}
 }
 
 auto TemplateOutput::attachOutput(memory::Array &dataArray, std::size_t &eventCount) -> void
@@ -241,6 +412,68 @@ auto TemplateOutput::updateWriteState(WriteSentinel &writeSentinel,
 {
 	// Update the write state
 	_writeState.update(writeSentinel, timeStamp, error, eventsToRaise);
+
+	// Remember the value the device now has. If the write failed, we don't know what the device has.
+	std::visit(
+		[&](auto &writtenValue) {
+			writtenValue.confirm(error ? std::nullopt : writtenValue._sent);
+
+			// Keep the values that could not be written, so they can be retried. This does not allocate, because both lists were
+			// preallocated for a whole batch.
+			if (error && !writtenValue._sentValues.empty() && _ioTransaction->writeRetriesEnabled())
+			{
+				writtenValue._retryValues.assign(writtenValue._sentValues.begin(), writtenValue._sentValues.end());
+				_ioTransaction->markOutputForRetry(_outputIndex);
+			}
+
+			writtenValue._sent.reset();
+			writtenValue._sentValues.clear();
+		},
+		_writtenValue);
+}
+
+auto TemplateOutput::updateReadBack(WriteSentinel &writeSentinel,
+	std::chrono::system_clock::time_point timeStamp,
+	PendingEventList &eventsToRaise) -> void
+{
+	std::visit(
+		[&]<typename DataType>(PerValueReadState<DataType> &state) {
+			// Use the value the device now has. If there is none, because all values were skipped as unchanged, the read-back value
+			// already matches it.
+			const auto &writtenValue = std::get<WrittenValue<DataType>>(_writtenValue);
+			if (writtenValue._confirmed)
+			{
+				state.update(writeSentinel, timeStamp, *writtenValue._confirmed, CommonReadState::Changes(), eventsToRaise);
+			}
+		},
+		_readState);
+}
+
+auto TemplateOutput::forgetWrittenValue() noexcept -> void
+{
+	// The confirmed value belongs to the writing thread, so we just tell it to forget it before it next writes
+	_writtenValueStale.store(true, std::memory_order_release);
+}
+
+auto TemplateOutput::checkReadBack(const ReadCommand::Payload &payload) noexcept -> void
+{
+	// Only outputs that skip unchanged values use the confirmed value
+	if (!_skipUnchanged)
+	{
+		return;
+	}
+
+	std::visit(
+		[&]<typename DataType>(const WrittenValue<DataType> &writtenValue) {
+			// Forget the confirmed value if the device holds something else, e.g. because it was changed on the device itself
+			if (writtenValue._published.load(std::memory_order_acquire) &&
+				DecodeTable<DataType>::decode(payload, _dataOffset, _wireType) !=
+					writtenValue._publishedValue.load(std::memory_order_relaxed))
+			{
+				forgetWrittenValue();
+			}
+		},
+		_writtenValue);
 }
 
 } // namespace xentara::plugins::templateDriver
\ No newline at end of file
@@ -3,15 +3,27 @@
 
 #include "AbstractInput.hpp"
 #include "AbstractOutput.hpp"
+#include "CustomError.hpp"
+#include "OutputQueue.hpp"
 #include "PerValueReadState.hpp"
+#include "ValueType.hpp"
+#include "WireType.hpp"
+#include "WriteGroup.hpp"
 #include "WriteState.hpp"
-#include "SingleValueQueue.hpp"
 
 #include <xentara/skill/DataPoint.hpp>
 #include <xentara/skill/EnableSharedFromThis.hpp>
 
+#include <atomic>
+#include <concepts>
+#include <cstddef>
 #include <functional>
+#include <optional>
+#include <span>
 #include <string_view>
+#include <system_error>
+#include <variant>
+#include <vector>
 
 namespace xentara::plugins::templateDriver
 {
@@ -70,19 +82,22 @@ public:
 		return _ioComponent;
 	}
 	
-	auto attachInput(memory::Array &dataArray, std::size_t &eventCount) -> void final;
-
-	auto updateReadState(WriteSentinel &writeSentinel,
-		std::chrono::system_clock::time_point timeStamp,
-		const utils::eh::expected<std::reference_wrapper<const ReadCommand::Payload>, std::error_code> &payloadOrError,
-		const CommonReadState::Changes &commonChanges,
-		PendingEventList &eventsToRaise) -> void final;
+	auto addToDecodePlan(DecodePlan &decodePlan) -> void final;
 	
 	/// @}
 
 	/// @name Virtual Overrides for AbstractOutput
 	/// @{
 
+	auto writeState() const noexcept -> const WriteState & final
+	{
+		return _writeState;
+	}
+
+	auto attachWriteGroup(WriteGroup &writeGroup) -> void final;
+
+	auto addWriteCapacity(std::size_t &valueCount, std::size_t &dataSize) const -> void final;
+
 	auto addToWriteCommand(WriteCommand &command) -> bool final;
 
 	auto attachOutput(memory::Array &dataArray, std::size_t &eventCount) -> void final;
@@ -92,24 +107,100 @@ public:
 		std::chrono::system_clock::time_point timeStamp,
 		std::error_code error,
 		PendingEventList &eventsToRaise) -> void final;
+
+	auto readsBackWrites() const noexcept -> bool final
+	{
+		return _readBackWrites;
+	}
+
+	auto updateReadBack(
+		WriteSentinel &writeSentinel,
+		std::chrono::system_clock::time_point timeStamp,
+		PendingEventList &eventsToRaise) -> void final;
+
+	auto forgetWrittenValue() noexcept -> void final;
+
+	auto checkReadBack(const ReadCommand::Payload &payload) noexcept -> void final;
 	
 	/// @}
 
-	/// @brief A Xentara attribute containing the current value.
+	/// @brief A Xentara attribute containing the current value, for boolean outputs.
 	/// @note This is a member of this class rather than of the attributes namespace, because the access flags
 	/// and type may differ from class to class
-	static const model::Attribute kValueAttribute;
+	static const model::Attribute kBooleanValueAttribute;
+	/// @brief A Xentara attribute containing the current value, for integer outputs.
+	static const model::Attribute kIntegerValueAttribute;
+	/// @brief A Xentara attribute containing the current value, for floating point outputs.
+	static const model::Attribute kFloatingPointValueAttribute;
 
 private:
+	/// @brief The values last written to the device, used to skip writing identical values
+	template <typename DataType>
+	struct WrittenValue final
+	{
+		/// @brief The last value that was successfully written, or std::nullopt if it is not known
+		std::optional<DataType> _confirmed;
+		/// @brief The last value added to the write command in progress, or std::nullopt if none was added
+		std::optional<DataType> _sent;
+		/// @brief All the values added to the write command in progress, in order. This is preallocated for a whole batch.
+		std::vector<DataType> _sentValues;
+		/// @brief The values that could not be written and must be retried, in order. This is preallocated for a whole batch.
+		///
+		/// For outputs that only keep the last value, this holds at most one value. For outputs with a queue, it holds the entire
+		/// batch that failed, so that no queued value is lost.
+		std::vector<DataType> _retryValues;
+
+		/// @brief A copy of _confirmed that checkReadBack() can read from other threads. This is only meaningful if _published is set.
+		/// @note This has no initializer, so that the structure stays default constructible within TemplateOutput. The default constructor
+		/// of std::atomic value-initializes it.
+		std::atomic<DataType> _publishedValue;
+		/// @brief Whether _publishedValue holds a confirmed value. This is initialized to *false* by the default constructor.
+		std::atomic<bool> _published;
+
+		/// @brief Sets the confirmed value, and publishes it for checkReadBack()
+		auto confirm(const std::optional<DataType> &value) noexcept -> void
+		{
+			_confirmed = value;
+			_published.store(false, std::memory_order_relaxed);
+			if (value)
+			{
+				_publishedValue.store(*value, std::memory_order_relaxed);
+				_published.store(true, std::memory_order_release);
+			}
+		}
+	};
+
 	/// @brief Schedules a value to be written.
 	/// 
-	/// This function is called by the value write handle.
-	/// @todo use the correct value type
-	auto scheduleOutputValue(double value) noexcept
+	/// This function is called by the value write handle, which is only ever created for the configured value type.
+	/// @return Returns CustomError::QueueFull if the output was configured to keep multiple values, and too many values
+	/// are already waiting to be written.
+	template <std::regular DataType>
+	auto scheduleOutputValue(DataType value) noexcept -> std::error_code
 	{
-		_pendingOutputValue.enqueue(value);
+		// Staged values are not queued, but placed in the write group to be released together with the other values of the group
+		if (_writeGroup)
+		{
+			_writeGroup->stage(_writeGroupSlot, std::as_bytes(std::span(&value, 1)));
+			return {};
+		}
+
+		if (!std::get<OutputQueue<DataType>>(_pendingOutputValue).enqueue(value))
+		{
+			return CustomError::QueueFull;
+		}
+		// Tell the I/O transaction that we have something to write
+		markPending();
+
+		return {};
 	}
 
+	/// @brief Marks the output as pending in the I/O transaction
+	auto markPending() noexcept -> void;
+
+	/// @brief Gets the value attribute matching the value type
+	auto valueAttribute() const noexcept -> const model::Attribute &;
+
 	/// @name Virtual Overrides for skill::DataPoint
 	/// @{
 
@@ -124,19 +215,49 @@ private:
 	/// @brief The I/O transaction this input belongs to, or nullptr if it hasn't been loaded yet.
 	/// @todo give this a more descriptive name, e.g. "_poll"
 	TemplateIoTransaction *_ioTransaction { nullptr };
+	/// @brief The index of the output within the I/O transaction
+	std::size_t _outputIndex { 0 };
+
+	/// @brief The type of the value
+	ValueType _valueType { ValueType::Double };
+
+	/// @brief The offset of the value within the payload of a read command, in bytes
+	std::size_t _dataOffset { 0 };
+	/// @brief The encoding of the value within the payload of a read command. This defaults to the native encoding of the value type.
+	WireType _wireType { WireType::Float64 };
 
 	/// @class xentara::plugins::templateDriver::TemplateOutput
-	/// @todo add information needed to decode the value from the payload of a read command, like e.g. a data offset.
+	/// @todo add any other information needed to decode the value from the payload of a read command.
 
-	/// @brief The read state
-	/// @todo use the correct value type
-	PerValueReadState<double> _readState;
+	/// @brief The read state, instantiated for the value type
+	ValueTypeVariant<PerValueReadState> _readState;
 	/// @brief The write state
 	WriteState _writeState;
 
-	/// @brief The queue for the pending output value
-	/// @todo use the correct value type
-	SingleValueQueue<double> _pendingOutputValue;
+	/// @brief The number of values that can be waiting to be written, or 0 to only write the last value.
+	std::size_t _queueSize { 0 };
+
+	/// @brief The queue for the pending output values, instantiated for the value type
+	ValueTypeVariant<OutputQueue> _pendingOutputValue;
+
+	/// @brief Whether values are staged in the write group of the I/O transaction, rather than being queued
+	bool _staged { false };
+	/// @brief The write group values are staged in, or nullptr if the output is not staged, or has not been attached yet
+	WriteGroup *_writeGroup { nullptr };
+	/// @brief The index of the slot of the output in the write group
+	std::size_t _writeGroupSlot { 0 };
+
+	/// @brief Whether successfully written values are reflected in the read-back value before the next read
+	bool _readBackWrites { false };
+
+	/// @brief Whether values identical to the value last written to the device are skipped
+	bool _skipUnchanged { false };
+	/// @brief The values last written to the device, instantiated for the value type.
+	/// @note Apart from the published copy of the confirmed value, this is only accessed by the I/O transaction while writing,
+	/// so it needs no synchronization.
+	ValueTypeVariant<WrittenValue> _writtenValue;
+	/// @brief Set on other threads if the confirmed value in _writtenValue must be forgotten before the next write
+	std::atomic<bool> _writtenValueStale { false };
 };
 
 } // namespace xentara::plugins::templateDriver
\ No newline at end of file
@@ -0,0 +1,50 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include <cmath>
+#include <concepts>
+#include <limits>
+#include <type_traits>
+
+namespace xentara::plugins::templateDriver
+{
+
+/// @brief Converts a value between the type used on the wire and the type used to store it
+///
+/// This is used in both directions: when decoding values read from the I/O component, and when encoding values to write.
+/// @tparam To The type to convert to
+/// @tparam From The type to convert from
+template <typename To, typename From>
+	requires std::is_arithmetic_v<To> && std::is_arithmetic_v<From>
+constexpr auto convertValue(From value) noexcept -> To
+{
+	// Any non-zero value is true
+	if constexpr (std::same_as<To, bool>)
+	{
+		return value != From();
+	}
+	// Converting out-of-range floating point values to integers is undefined, so we saturate them
+	else if constexpr (std::is_integral_v<To> && std::is_floating_point_v<From>)
+	{
+		if (std::isnan(value))
+		{
+			return To();
+		}
+		if (double(value) <= double(std::numeric_limits<To>::lowest()))
+		{
+			return std::numeric_limits<To>::lowest();
+		}
+		if (double(value) >= double(std::numeric_limits<To>::max()))
+		{
+			return std::numeric_limits<To>::max();
+		}
+		return To(value);
+	}
+	// If the types are the same, this is a no-op
+	else
+	{
+		return static_cast<To>(value);
+	}
+}
+
+} // namespace xentara::plugins::templateDriver
@@ -0,0 +1,90 @@
+// Copyright (c) embedded ocean GmbH
+#include "ValueType.hpp"
+
+#include <string_view>
+
+namespace xentara::plugins::templateDriver
+{
+
+using namespace std::literals;
+
+auto parseValueType(std::string_view name) noexcept -> std::optional<ValueType>
+{
+	if (name == "bool"sv)
+	{
+		return ValueType::Boolean;
+	}
+	else if (name == "int8"sv)
+	{
+		return ValueType::Int8;
+	}
+	else if (name == "uint8"sv)
+	{
+		return ValueType::UInt8;
+	}
+	else if (name == "int16"sv)
+	{
+		return ValueType::Int16;
+	}
+	else if (name == "uint16"sv)
+	{
+		return ValueType::UInt16;
+	}
+	else if (name == "int32"sv)
+	{
+		return ValueType::Int32;
+	}
+	else if (name == "uint32"sv)
+	{
+		return ValueType::UInt32;
+	}
+	else if (name == "int64"sv)
+	{
+		return ValueType::Int64;
+	}
+	else if (name == "uint64"sv)
+	{
+		return ValueType::UInt64;
+	}
+	else if (name == "float"sv)
+	{
+		return ValueType::Float;
+	}
+	else if (name == "double"sv)
+	{
+		return ValueType::Double;
+	}
+
+	return std::nullopt;
+}
+
+auto nativeWireType(ValueType valueType) noexcept -> WireType
+{
+	switch (valueType)
+	{
+	case ValueType::Boolean:
+	case ValueType::UInt8:
+		return WireType::UInt8;
+	case ValueType::Int8:
+		return WireType::Int8;
+	case ValueType::Int16:
+		return WireType::Int16;
+	case ValueType::UInt16:
+		return WireType::UInt16;
+	case ValueType::Int32:
+		return WireType::Int32;
+	case ValueType::UInt32:
+		return WireType::UInt32;
+	case ValueType::Int64:
+		return WireType::Int64;
+	case ValueType::UInt64:
+		return WireType::UInt64;
+	case ValueType::Float:
+		return WireType::Float32;
+	case ValueType::Double:
+	default:
+		return WireType::Float64;
+	}
+}
+
+} // namespace xentara::plugins::templateDriver
@@ -0,0 +1,122 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include "WireType.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <variant>
+
+namespace xentara::plugins::templateDriver
+{
+
+/// @brief The C++ type used to store the value of an input or output
+/// @todo add any other types supported by the I/O component
+enum class ValueType : std::uint8_t
+{
+	/// @brief A boolean value (bool)
+	Boolean,
+	/// @brief A signed 8-bit integer (std::int8_t)
+	Int8,
+	/// @brief An unsigned 8-bit integer (std::uint8_t)
+	UInt8,
+	/// @brief A signed 16-bit integer (std::int16_t)
+	Int16,
+	/// @brief An unsigned 16-bit integer (std::uint16_t)
+	UInt16,
+	/// @brief A signed 32-bit integer (std::int32_t)
+	Int32,
+	/// @brief An unsigned 32-bit integer (std::uint32_t)
+	UInt32,
+	/// @brief A signed 64-bit integer (std::int64_t)
+	Int64,
+	/// @brief An unsigned 64-bit integer (std::uint64_t)
+	UInt64,
+	/// @brief A single precision floating point number (float)
+	Float,
+	/// @brief A double precision floating point number (double)
+	Double
+};
+
+/// @brief A variant holding a class template instantiated for one of the types corresponding to the value types.
+///
+/// The first alternative is the one for double, so that a default constructed variant uses double.
+template <template <typename> typename Template>
+using ValueTypeVariant = std::variant<Template<double>,
+	Template<float>,
+	Template<bool>,
+	Template<std::int8_t>,
+	Template<std::uint8_t>,
+	Template<std::int16_t>,
+	Template<std::uint16_t>,
+	Template<std::int32_t>,
+	Template<std::uint32_t>,
+	Template<std::int64_t>,
+	Template<std::uint64_t>>;
+
+/// @brief A tuple holding a class template instantiated for all the types corresponding to the value types.
+template <template <typename> typename Template>
+using ValueTypeTuple = std::tuple<Template<double>,
+	Template<float>,
+	Template<bool>,
+	Template<std::int8_t>,
+	Template<std::uint8_t>,
+	Template<std::int16_t>,
+	Template<std::uint16_t>,
+	Template<std::int32_t>,
+	Template<std::uint32_t>,
+	Template<std::int64_t>,
+	Template<std::uint64_t>>;
+
+/// @brief Calls a function with an std::type_identity object for the C++ type corresponding to a value type
+/// @param valueType The value type
+/// @param function The function to call. Must be callable with an std::type_identity object for each supported type.
+/// @return The return value of the function
+template <typename Function>
+auto visitValueType(ValueType valueType, Function &&function) -> decltype(auto)
+{
+	switch (valueType)
+	{
+	case ValueType::Boolean:
+		return function(std::type_identity<bool>());
+	case ValueType::Int8:
+		return function(std::type_identity<std::int8_t>());
+	case ValueType::UInt8:
+		return function(std::type_identity<std::uint8_t>());
+	case ValueType::Int16:
+		return function(std::type_identity<std::int16_t>());
+	case ValueType::UInt16:
+		return function(std::type_identity<std::uint16_t>());
+	case ValueType::Int32:
+		return function(std::type_identity<std::int32_t>());
+	case ValueType::UInt32:
+		return function(std::type_identity<std::uint32_t>());
+	case ValueType::Int64:
+		return function(std::type_identity<std::int64_t>());
+	case ValueType::UInt64:
+		return function(std::type_identity<std::uint64_t>());
+	case ValueType::Float:
+		return function(std::type_identity<float>());
+	case ValueType::Double:
+	default:
+		return function(std::type_identity<double>());
+	}
+}
+
+/// @brief Parses the name of a value type, as used in the configuration
+/// @return The value type, or std::nullopt if the name is unknown
+auto parseValueType(std::string_view name) noexcept -> std::optional<ValueType>;
+
+/// @brief Gets the wire type that encodes a value type without any conversion
+auto nativeWireType(ValueType valueType) noexcept -> WireType;
+
+/// @brief Checks whether deadbands can be used with a value type
+constexpr auto supportsDeadband(ValueType valueType) noexcept -> bool
+{
+	return valueType != ValueType::Boolean;
+}
+
+} // namespace xentara::plugins::templateDriver
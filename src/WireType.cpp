@@ -0,0 +1,57 @@
+// Copyright (c) embedded ocean GmbH
+#include "WireType.hpp"
+
+#include <string_view>
+
+namespace xentara::plugins::templateDriver
+{
+
+using namespace std::literals;
+
+auto parseWireType(std::string_view name) noexcept -> std::optional<WireType>
+{
+	if (name == "int8"sv)
+	{
+		return WireType::Int8;
+	}
+	else if (name == "uint8"sv)
+	{
+		return WireType::UInt8;
+	}
+	else if (name == "int16"sv)
+	{
+		return WireType::Int16;
+	}
+	else if (name == "uint16"sv)
+	{
+		return WireType::UInt16;
+	}
+	else if (name == "int32"sv)
+	{
+		return WireType::Int32;
+	}
+	else if (name == "uint32"sv)
+	{
+		return WireType::UInt32;
+	}
+	else if (name == "int64"sv)
+	{
+		return WireType::Int64;
+	}
+	else if (name == "uint64"sv)
+	{
+		return WireType::UInt64;
+	}
+	else if (name == "float32"sv)
+	{
+		return WireType::Float32;
+	}
+	else if (name == "float64"sv)
+	{
+		return WireType::Float64;
+	}
+
+	return std::nullopt;
+}
+
+} // namespace xentara::plugins::templateDriver
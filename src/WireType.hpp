@@ -0,0 +1,68 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace xentara::plugins::templateDriver
+{
+
+/// @brief The encoding of a value within the payload of a read command
+/// @todo add any other encodings supported by the I/O component
+enum class WireType : std::uint8_t
+{
+	/// @brief A signed 8-bit integer
+	Int8,
+	/// @brief An unsigned 8-bit integer
+	UInt8,
+	/// @brief A signed 16-bit integer
+	Int16,
+	/// @brief An unsigned 16-bit integer
+	UInt16,
+	/// @brief A signed 32-bit integer
+	Int32,
+	/// @brief An unsigned 32-bit integer
+	UInt32,
+	/// @brief A signed 64-bit integer
+	Int64,
+	/// @brief An unsigned 64-bit integer
+	UInt64,
+	/// @brief An IEEE 754 single precision floating point number
+	Float32,
+	/// @brief An IEEE 754 double precision floating point number
+	Float64
+};
+
+/// @brief Gets the number of bytes a value of a certain wire type occupies in the payload
+constexpr auto wireSize(WireType wireType) noexcept -> std::size_t
+{
+	switch (wireType)
+	{
+	case WireType::Int8:
+	case WireType::UInt8:
+		return 1;
+
+	case WireType::Int16:
+	case WireType::UInt16:
+		return 2;
+
+	case WireType::Int32:
+	case WireType::UInt32:
+	case WireType::Float32:
+		return 4;
+
+	case WireType::Int64:
+	case WireType::UInt64:
+	case WireType::Float64:
+	default:
+		return 8;
+	}
+}
+
+/// @brief Parses the name of a wire type, as used in the configuration
+/// @return The wire type, or std::nullopt if the name is unknown
+auto parseWireType(std::string_view name) noexcept -> std::optional<WireType>;
+
+} // namespace xentara::plugins::templateDriver
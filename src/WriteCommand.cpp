@@ -0,0 +1,76 @@
+// Copyright (c) embedded ocean GmbH
+#include "WriteCommand.hpp"
+
+#include <algorithm>
+#include <tuple>
+
+namespace xentara::plugins::templateDriver
+{
+
+auto WriteCommand::reset(std::size_t maxValueCount, std::size_t maxDataSize, std::size_t gapTolerance, std::size_t maxRangeSize)
+	-> void
+{
+	_gapTolerance = gapTolerance;
+	_maxRangeSize = maxRangeSize;
+
+	_items.reserve(maxValueCount);
+	_valueData.reserve(maxDataSize);
+	_ranges.reserve(maxValueCount);
+	_rangeData.reserve(maxDataSize + gapTolerance * maxValueCount);
+
+	clear();
+}
+
+auto WriteCommand::clear() noexcept -> void
+{
+	_items.clear();
+	_valueData.clear();
+	_ranges.clear();
+	_rangeData.clear();
+}
+
+auto WriteCommand::sortItems() noexcept -> void
+{
+	// Sort by address first, keeping values for the same address in the order they were added. std::stable_sort()
+	// may allocate memory, so we use the sequence number to break ties instead.
+	std::sort(_items.begin(), _items.end(), [](const Item &left, const Item &right) {
+		return std::tie(left._address, left._sequence) < std::tie(right._address, right._sequence);
+	});
+
+	// Number the values for the same address, so that the first value for each address ends up in the first set of ranges,
+	// the second value in the second set, and so on.
+	bool hasDuplicates = false;
+	for (std::size_t index = 1; index < _items.size(); ++index)
+	{
+		if (_items[index]._address == _items[index - 1]._address)
+		{
+			_items[index]._generation = _items[index - 1]._generation + 1;
+			hasDuplicates = true;
+		}
+	}
+
+	// Sort the values by generation, so that each set of ranges can be written in order. Most of the time, there is only
+	// a single generation, and the items are already sorted.
+	if (hasDuplicates)
+	{
+		std::sort(_items.begin(), _items.end(), [](const Item &left, const Item &right) {
+			return std::tie(left._generation, left._address) < std::tie(right._generation, right._address);
+		});
+	}
+}
+
+auto WriteCommand::canAppend(const Range &range, const Item &item) const noexcept -> bool
+{
+	const auto rangeEnd = range._address + range._data.size();
+
+	// The item must not overlap the range, and must not be too far away
+	if (item._address < rangeEnd || item._address - rangeEnd > _gapTolerance)
+	{
+		return false;
+	}
+
+	// The range must not get too large
+	return _maxRangeSize == 0 || item._address + item._size - range._address <= _maxRangeSize;
+}
+
+} // namespace xentara::plugins::templateDriver
@@ -1,15 +1,188 @@
 // Copyright (c) embedded ocean GmbH
 #pragma once
 
+#include "ValueConversion.hpp"
+#include "WireType.hpp"
+
 #include <xentara/utils/tools/Unique.hpp>
 
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+
 namespace xentara::plugins::templateDriver
 {
 
 /// @brief A command used to write outputs
-/// @todo implement a proper write command
+///
+/// The command collects the encoded values of all the outputs to write, together with their addresses, and merges them
+/// into as few contiguous address ranges as possible. Each range can then be sent to the I/O component using a single request.
+///
+/// The command is reused for every write, and all its buffers are preallocated by reset(), so that collecting and merging
+/// values does not require any memory allocations.
+/// @todo add any information needed to construct the actual requests
 class WriteCommand final : private utils::tools::Unique
 {
+public:
+	/// @brief A contiguous range of addresses to write
+	struct Range final
+	{
+		/// @brief The address of the first byte
+		std::size_t _address;
+		/// @brief The encoded data to write
+		std::span<const std::byte> _data;
+	};
+
+	/// @brief Preallocates the buffers and sets the merge parameters
+	/// @param maxValueCount The maximum number of values that can be added to a single command
+	/// @param maxDataSize The maximum total size of the encoded values added to a single command, in bytes
+	/// @param gapTolerance The maximum number of bytes between two values that may be bridged to merge them into the same range.
+	/// @param maxRangeSize The maximum size of a range, in bytes, or 0 for no limit
+	auto reset(std::size_t maxValueCount, std::size_t maxDataSize, std::size_t gapTolerance, std::size_t maxRangeSize) -> void;
+
+	/// @brief Removes all the values, so the command can be reused
+	auto clear() noexcept -> void;
+
+	/// @brief Checks whether any values were added
+	auto empty() const noexcept -> bool
+	{
+		return _items.empty();
+	}
+
+	/// @brief Adds a value
+	///
+	/// If several values are added for the same address, they are written in the order they were added, using separate ranges.
+	/// @param address The address to write the value to
+	/// @param wireType The encoding to use
+	/// @param value The value to write
+	template <typename DataType>
+	auto add(std::size_t address, WireType wireType, DataType value) -> void
+	{
+		switch (wireType)
+		{
+		case WireType::Int8:
+			return addEncoded(address, convertValue<std::int8_t>(value));
+		case WireType::UInt8:
+			return addEncoded(address, convertValue<std::uint8_t>(value));
+		case WireType::Int16:
+			return addEncoded(address, convertValue<std::int16_t>(value));
+		case WireType::UInt16:
+			return addEncoded(address, convertValue<std::uint16_t>(value));
+		case WireType::Int32:
+			return addEncoded(address, convertValue<std::int32_t>(value));
+		case WireType::UInt32:
+			return addEncoded(address, convertValue<std::uint32_t>(value));
+		case WireType::Int64:
+			return addEncoded(address, convertValue<std::int64_t>(value));
+		case WireType::UInt64:
+			return addEncoded(address, convertValue<std::uint64_t>(value));
+		case WireType::Float32:
+			return addEncoded(address, convertValue<float>(value));
+		case WireType::Float64:
+		default:
+			return addEncoded(address, convertValue<double>(value));
+		}
+	}
+
+	/// @brief Merges the values into contiguous ranges
+	///
+	/// Values are sorted by address, and neighbouring values are merged if the gap between them is within the gap tolerance,
+	/// and the resulting range does not exceed the maximum range size. Since the bytes in a gap are written too, they must
+	/// hold the current contents of the device. A gap is only bridged if the gap filler can provide them.
+	/// @param fillGap A function with the signature `bool(std::size_t address, std::span<std::byte> gap)` that fills
+	/// the bytes of a gap. It must return *false* if the current contents are not known, in which case the gap is not bridged.
+	/// @return The ranges to write. They remain valid until the command is cleared. Ranges that write the same address
+	/// several times are returned in the order the values were added.
+	template <typename GapFiller>
+	auto merge(GapFiller &&fillGap) -> std::span<const Range>
+	{
+		sortItems();
+
+		// Make room for the worst case, so the spans in the ranges stay valid
+		_rangeData.resize(_valueData.size() + _gapTolerance * _items.size());
+
+		_ranges.clear();
+		std::size_t rangeDataSize = 0;
+		std::size_t rangeGeneration = 0;
+		for (auto &&item : _items)
+		{
+			const auto data = std::span(_valueData).subspan(item._dataOffset, item._size);
+
+			// Check if we can append the item to the last range
+			if (!_ranges.empty() && item._generation == rangeGeneration && canAppend(_ranges.back(), item))
+			{
+				auto &range = _ranges.back();
+				const auto rangeEnd = range._address + range._data.size();
+				const auto gapSize = item._address - rangeEnd;
+				if (gapSize == 0 || fillGap(rangeEnd, std::span(_rangeData).subspan(rangeDataSize, gapSize)))
+				{
+					std::memcpy(_rangeData.data() + rangeDataSize + gapSize, data.data(), data.size());
+					rangeDataSize += gapSize + data.size();
+					range._data = { range._data.data(), range._data.size() + gapSize + data.size() };
+					continue;
+				}
+			}
+
+			// Start a new range
+			std::memcpy(_rangeData.data() + rangeDataSize, data.data(), data.size());
+			_ranges.push_back({ item._address, std::span(_rangeData).subspan(rangeDataSize, data.size()) });
+			rangeDataSize += data.size();
+			rangeGeneration = item._generation;
+		}
+
+		return _ranges;
+	}
+
+private:
+	/// @brief A value that was added
+	struct Item final
+	{
+		/// @brief The address
+		std::size_t _address;
+		/// @brief The offset of the encoded value within _valueData
+		std::size_t _dataOffset;
+		/// @brief The size of the encoded value
+		std::size_t _size;
+		/// @brief The position of the value in the order the values were added
+		std::size_t _sequence;
+		/// @brief The number of values for the same address that were added before this one
+		std::size_t _generation { 0 };
+	};
+
+	/// @brief Adds an encoded value
+	template <typename WireValue>
+	auto addEncoded(std::size_t address, WireValue wireValue) -> void
+	{
+		const auto dataOffset = _valueData.size();
+		_valueData.resize(dataOffset + sizeof(WireValue));
+		/// @todo convert the value to the byte order used by the I/O component, if necessary
+		std::memcpy(_valueData.data() + dataOffset, &wireValue, sizeof(WireValue));
+
+		_items.push_back({ address, dataOffset, sizeof(WireValue), _items.size() });
+	}
+
+	/// @brief Sorts the items by generation and address, so that contiguous items of the same generation are next to each other
+	auto sortItems() noexcept -> void;
+
+	/// @brief Checks whether an item can be appended to a range without overlapping or exceeding the limits
+	auto canAppend(const Range &range, const Item &item) const noexcept -> bool;
+
+	/// @brief The maximum gap to bridge, in bytes
+	std::size_t _gapTolerance { 0 };
+	/// @brief The maximum size of a range, in bytes, or 0 for no limit
+	std::size_t _maxRangeSize { 0 };
+
+	/// @brief The values that were added
+	std::vector<Item> _items;
+	/// @brief The encoded data of the values that were added
+	std::vector<std::byte> _valueData;
+
+	/// @brief The merged ranges
+	std::vector<Range> _ranges;
+	/// @brief The data of the merged ranges, including any bridged gaps
+	std::vector<std::byte> _rangeData;
 };
 
-} // namespace xentara::plugins::templateDriver
\ No newline at end of file
+} // namespace xentara::plugins::templateDriver
@@ -0,0 +1,237 @@
+// Copyright (c) embedded ocean GmbH
+#pragma once
+
+#include <xentara/utils/tools/Unique.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace xentara::plugins::templateDriver
+{
+
+/// @brief A set of output values that are staged one by one, and then released to be written together.
+///
+/// The values are held in three buffers: producers stage values in the back buffer, and release them by exchanging
+/// the back buffer with the middle buffer in a single atomic operation. The consumer picks up released values by
+/// exchanging the middle buffer with the front buffer. The consumer never waits for the producers, and always sees a
+/// complete set of values. If values are released again before the consumer has picked up the last release, the two
+/// releases are merged, with the newer values replacing older values for the same outputs.
+///
+/// @note Values may be staged and released by any number of threads, e.g. by the write handles of outputs written from
+/// different pipelines, and by the release task. Producers are serialized by a mutex. Values must only be picked up by a single
+/// thread at a time.
+class WriteGroup final : private utils::tools::Unique
+{
+public:
+	/// @brief Adds a slot for the value of an output.
+	/// @param outputIndex The index of the output within the I/O transaction
+	/// @param size The size of the value, in bytes
+	/// @return The index of the slot, to be passed to stage() and take()
+	/// @note This must be called before allocate().
+	auto addSlot(std::size_t outputIndex, std::size_t size) -> std::size_t
+	{
+		_slots.push_back({ outputIndex, _dataSize, size });
+		_dataSize += size;
+		return _slots.size() - 1;
+	}
+
+	/// @brief Checks whether any slots were added
+	auto empty() const noexcept -> bool
+	{
+		return _slots.empty();
+	}
+
+	/// @brief Allocates the buffers once all slots have been added
+	auto allocate() -> void
+	{
+		for (auto &&buffer : _buffers)
+		{
+			buffer._data = std::make_unique_for_overwrite<std::byte[]>(_dataSize);
+			buffer._staged = std::make_unique<bool[]>(_slots.size());
+			buffer._stagedCount = 0;
+		}
+	}
+
+	/// @brief Stages a value in the back buffer. This is called by the producer.
+	///
+	/// If a value was already staged for the slot since the last release, it is replaced.
+	/// @param slotIndex The index returned by addSlot()
+	/// @param value The value. Its size must be the size passed to addSlot().
+	auto stage(std::size_t slotIndex, std::span<const std::byte> value) noexcept -> void
+	{
+		std::lock_guard lock { _producerMutex };
+
+		auto &buffer = _buffers[_backIndex];
+		const auto &slot = _slots[slotIndex];
+		std::memcpy(buffer._data.get() + slot._offset, value.data(), slot._size);
+		if (!std::exchange(buffer._staged[slotIndex], true))
+		{
+			++buffer._stagedCount;
+		}
+	}
+
+	/// @brief Releases all the staged values to be written together. This is called by the producer.
+	/// @return Returns *true* if any values were released
+	auto release() noexcept -> bool
+	{
+		std::lock_guard lock { _producerMutex };
+
+		// Don't release an empty buffer
+		if (_buffers[_backIndex]._stagedCount == 0)
+		{
+			return false;
+		}
+
+		// If the last release has not been picked up yet, take it back, so that values for outputs that were not staged again
+		// are not lost. We park the back buffer in the middle without the fresh flag while merging, so the consumer leaves it alone.
+		auto middle = _middle.load(std::memory_order_acquire);
+		if ((middle & kFresh) != 0 && _middle.compare_exchange_strong(middle, _backIndex, std::memory_order_acq_rel))
+		{
+			const auto reclaimedIndex = std::uint8_t(middle & kIndexMask);
+			merge(_buffers[reclaimedIndex], _buffers[_backIndex]);
+			_backIndex = reclaimedIndex;
+		}
+
+		// Publish the back buffer, and take over the buffer that was there before. This is either the empty buffer the consumer
+		// handed back, or the back buffer we parked while merging, which merge() has emptied.
+		const auto previous = _middle.exchange(_backIndex | kFresh, std::memory_order_acq_rel);
+		_backIndex = previous & kIndexMask;
+
+		return true;
+	}
+
+	/// @brief Picks up the last released values, if the values picked up before have all been taken. This is called by the consumer.
+	/// @param function A function that is called with the output index of each value that was picked up
+	/// @return Returns *true* if values were picked up
+	template <typename Function>
+	auto acquire(Function &&function) -> bool
+	{
+		// Only move on to the next release once all values of the current one were written, so that none are lost
+		if (_buffers[_frontIndex]._stagedCount > 0)
+		{
+			return false;
+		}
+		// Check if there was a new release
+		auto middle = _middle.load(std::memory_order_relaxed);
+		if ((middle & kFresh) == 0)
+		{
+			return false;
+		}
+
+		// Exchange the front buffer for the released one. This fails if a producer took the release back in the meantime to
+		// merge it with a newer one, in which case we pick up the merged release next time.
+		if (!_middle.compare_exchange_strong(middle, _frontIndex, std::memory_order_acq_rel))
+		{
+			return false;
+		}
+		_frontIndex = middle & kIndexMask;
+
+		// Report all the values that were released
+		const auto &buffer = _buffers[_frontIndex];
+		for (std::size_t slotIndex = 0; slotIndex < _slots.size(); ++slotIndex)
+		{
+			if (buffer._staged[slotIndex])
+			{
+				function(_slots[slotIndex]._outputIndex);
+			}
+		}
+
+		return true;
+	}
+
+	/// @brief Takes a value that was picked up using acquire(). This is called by the consumer.
+	/// @param slotIndex The index returned by addSlot()
+	/// @param value Receives the value. Its size must be the size passed to addSlot().
+	/// @return Returns *true* if a value was taken, or *false* if there was none.
+	auto take(std::size_t slotIndex, std::span<std::byte> value) noexcept -> bool
+	{
+		auto &buffer = _buffers[_frontIndex];
+		if (!buffer._staged[slotIndex])
+		{
+			return false;
+		}
+
+		const auto &slot = _slots[slotIndex];
+		std::memcpy(value.data(), buffer._data.get() + slot._offset, slot._size);
+		buffer._staged[slotIndex] = false;
+		--buffer._stagedCount;
+		return true;
+	}
+
+private:
+	/// @brief A slot in the buffers
+	struct Slot final
+	{
+		/// @brief The index of the output within the I/O transaction
+		std::size_t _outputIndex;
+		/// @brief The offset of the value within the data of a buffer
+		std::size_t _offset;
+		/// @brief The size of the value
+		std::size_t _size;
+	};
+
+	/// @brief A buffer
+	struct Buffer final
+	{
+		/// @brief The values
+		std::unique_ptr<std::byte[]> _data;
+		/// @brief Which slots contain a value
+		std::unique_ptr<bool[]> _staged;
+		/// @brief The number of slots that contain a value
+		std::size_t _stagedCount { 0 };
+	};
+
+	/// @brief The mask to extract the buffer index from _middle
+	static constexpr std::uint8_t kIndexMask = 0x03;
+	/// @brief The flag in _middle that is set if the middle buffer was released and not yet picked up
+	static constexpr std::uint8_t kFresh = 0x04;
+
+	/// @brief Moves all values from one buffer into another, replacing any values the target already has for the same slots
+	/// @param target The buffer to move the values into
+	/// @param source The buffer to move the values from. This is empty afterwards.
+	auto merge(Buffer &target, Buffer &source) noexcept -> void
+	{
+		for (std::size_t slotIndex = 0; slotIndex < _slots.size() && source._stagedCount > 0; ++slotIndex)
+		{
+			if (!std::exchange(source._staged[slotIndex], false))
+			{
+				continue;
+			}
+			--source._stagedCount;
+
+			const auto &slot = _slots[slotIndex];
+			std::memcpy(target._data.get() + slot._offset, source._data.get() + slot._offset, slot._size);
+			if (!std::exchange(target._staged[slotIndex], true))
+			{
+				++target._stagedCount;
+			}
+		}
+	}
+
+	/// @brief The slots
+	std::vector<Slot> _slots;
+	/// @brief The total size of the values
+	std::size_t _dataSize { 0 };
+
+	/// @brief The buffers
+	Buffer _buffers[3];
+
+	/// @brief A mutex that serializes the producers
+	std::mutex _producerMutex;
+	/// @brief The index of the buffer values are staged in. This is only used by the producers, while holding _producerMutex.
+	std::uint8_t _backIndex { 0 };
+	/// @brief The index of the released buffer, together with the kFresh flag
+	std::atomic<std::uint8_t> _middle { 1 };
+	/// @brief The index of the buffer values are taken from. This is only used by the consumer.
+	std::uint8_t _frontIndex { 2 };
+};
+
+} // namespace xentara::plugins::templateDriver